@@ -0,0 +1,265 @@
+#include "bench.hpp"
+
+namespace bench {
+
+struct bench_entry {
+  const char *name;
+  void (*run)();
+  // Also run when no benchmark is named
+  bool by_default;
+};
+
+static const bench_entry benches[] = {
+    {"syscalls", &syscalls, true},
+    {"dispatch", &dispatch, true},
+    {"clients", &clients, true},
+    {"members", &members, true},
+    {"names", &names, true},
+    {"bytes", &bytes, true},
+    {"wildcard", &wildcard, true},
+    {"replies", &replies, true},
+    {"timers", &timers, true},
+    {"loadtest", &loadtest, false},
+};
+static const size_t bench_count = sizeof(benches) / sizeof(benches[0]);
+
+volatile size_t sink;
+static size_t allocation_count;
+static std::map<std::string, std::string> options;
+static bool failed;
+
+size_t allocations() { return allocation_count; }
+
+uint64_t now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+uint32_t next_random(uint32_t &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+void report(const char *bench, const std::string &what, double value,
+            const char *unit) {
+  std::cout << bench << ": " << what << ' ' << value << ' ' << unit
+            << std::endl;
+}
+
+void fail(const char *bench, const std::string &why) {
+  std::cout << bench << ": FAILED: " << why << std::endl;
+  failed = true;
+}
+
+size_t size_option(const std::string &name, size_t fallback) {
+  std::map<std::string, std::string>::const_iterator found =
+      options.find(name);
+  if (found == options.end()) return fallback;
+  return strtoul(found->second.c_str(), NULL, 10);
+}
+
+pid_t start_server(int port, const std::vector<std::string> &options,
+                   void (*before_exec)(pid_t, void *), void *arg) {
+  // The child waits on the pipe until before_exec is done
+  int gate[2];
+  if (pipe(gate) < 0) return -1;
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(gate[0]);
+    close(gate[1]);
+    return -1;
+  }
+  if (pid == 0) {
+    close(gate[1]);
+    char go;
+    if (read(gate[0], &go, 1) != 1) _exit(EXIT_FAILURE);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+
+    std::ostringstream port_arg;
+    port_arg << port;
+    std::vector<std::string> args;
+    args.push_back("ircserv");
+    args.push_back(port_arg.str());
+    args.push_back(BENCH_PASSWORD);
+    args.insert(args.end(), options.begin(), options.end());
+    std::vector<char *> argv;
+    for (size_t i = 0; i < args.size(); ++i)
+      argv.push_back(const_cast<char *>(args[i].c_str()));
+    argv.push_back(NULL);
+    execv("./ircserv", &argv[0]);
+    _exit(EXIT_FAILURE);
+  }
+
+  close(gate[0]);
+  if (before_exec) before_exec(pid, arg);
+  if (write(gate[1], "x", 1) != 1) kill(pid, SIGKILL);
+  close(gate[1]);
+
+  // Up once it accepts connections; if it exited, the port belongs to
+  // another process
+  for (int tries = 0; tries < 100; ++tries) {
+    if (waitpid(pid, NULL, WNOHANG) == pid) return -1;
+    int fd = connect_client(port, INADDR_ANY);
+    if (fd >= 0) {
+      close(fd);
+      usleep(20000);
+      if (waitpid(pid, NULL, WNOHANG) == pid) return -1;
+      return pid;
+    }
+    usleep(20000);
+  }
+  stop_server(pid);
+  return -1;
+}
+
+void stop_server(pid_t pid) {
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+}
+
+int connect_client(int port, in_addr_t source) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  if (source != INADDR_ANY) {
+    // The port is picked on connect(), bind() would search for one that no
+    // other socket has bound, which gets slow with many thousands of them
+    int one = 1;
+    setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+    addr.sin_addr.s_addr = source;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      close(fd);
+      return -1;
+    }
+  }
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool read_line_with(int fd, const std::string &needle, std::string &line) {
+  std::string data;
+  char chunk[BUFFERSIZE];
+  uint64_t deadline = now_ns() + (uint64_t)BENCH_TIMEOUT_MS * 1000000;
+  while (now_ns() < deadline) {
+    size_t found = data.find(needle);
+    size_t end = found == std::string::npos
+                     ? found
+                     : data.find('\n', found + needle.size());
+    if (end != std::string::npos) {
+      line = data.substr(found, end - found);
+      return true;
+    }
+    struct pollfd ready;
+    ready.fd = fd;
+    ready.events = POLLIN;
+    if (poll(&ready, 1, 100) <= 0) continue;
+    ssize_t n_read = read(fd, chunk, sizeof(chunk));
+    if (n_read <= 0) return false;
+    data.append(chunk, n_read);
+  }
+  return false;
+}
+
+bool drain_lines(const std::vector<int> &fds, size_t lines) {
+  std::vector<struct pollfd> ready(fds.size());
+  for (size_t i = 0; i < fds.size(); ++i) {
+    ready[i].fd = fds[i];
+    ready[i].events = POLLIN;
+  }
+  char chunk[65536];
+  uint64_t deadline = now_ns() + (uint64_t)BENCH_TIMEOUT_MS * 1000000;
+  bool until_quiet = !lines;
+  while ((lines || until_quiet) && now_ns() < deadline) {
+    int n_ready = poll(&ready[0], ready.size(), 100);
+    if (until_quiet && n_ready == 0) return true;
+    if (n_ready <= 0) continue;
+    for (size_t i = 0; i < ready.size(); ++i) {
+      if (!(ready[i].revents & POLLIN)) continue;
+      ssize_t n_read = read(fds[i], chunk, sizeof(chunk));
+      if (n_read <= 0) return false;
+      size_t got = std::count(chunk, chunk + n_read, '\n');
+      lines -= std::min(lines, got);
+    }
+  }
+  return !lines;
+}
+
+bool read_until(int fd, const std::string &needle) {
+  std::string line;
+  return read_line_with(fd, needle, line);
+}
+
+void send_line(int fd, const std::string &line) {
+  std::string data = line + "\r\n";
+  for (size_t sent = 0; sent < data.size();) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) return;
+    sent += n;
+  }
+}
+
+bool register_client(int fd, const std::string &nick) {
+  std::string ping;
+  if (!read_line_with(fd, "\nPING ", ping)) return false;
+  std::string token = ping.substr(6);
+  if (!token.empty() && token[token.size() - 1] == '\r')
+    token.erase(token.size() - 1);
+
+  send_line(fd, "PASS " BENCH_PASSWORD);
+  send_line(fd, "PONG " + token);
+  send_line(fd, "NICK " + nick);
+  send_line(fd, "USER " + nick + " 0 * :bench");
+  return read_until(fd, " 001 ");
+}
+
+}  // namespace bench
+
+// Counted for the allocation figures, new[] ends up here as well
+void *operator new(size_t size) throw(std::bad_alloc) {
+  ++bench::allocation_count;
+  void *memory = malloc(size ? size : 1);
+  if (!memory) throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void *memory) throw() { free(memory); }
+
+/**
+ * @brief Runs the benchmarks named on the command line, without names all
+ * but the load test. Arguments "--name=value" are options for them. Those
+ * that start a server expect ./ircserv to be built.
+ *
+ * @return EXIT_FAILURE if a benchmark checks a limit and it was exceeded
+ */
+int main(int argc, char **argv) {
+  signal(SIGPIPE, SIG_IGN);
+  std::vector<std::string> names;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    size_t pos_eq = arg.find('=');
+    if (arg.compare(0, 2, "--") == 0 && pos_eq != std::string::npos)
+      bench::options[arg.substr(2, pos_eq - 2)] = arg.substr(pos_eq + 1);
+    else
+      names.push_back(arg);
+  }
+
+  for (size_t i = 0; i < bench::bench_count; ++i) {
+    bool wanted = names.empty() && bench::benches[i].by_default;
+    for (size_t j = 0; j < names.size(); ++j)
+      if (names[j] == bench::benches[i].name) wanted = true;
+    if (wanted) bench::benches[i].run();
+  }
+  return bench::failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
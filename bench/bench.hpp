@@ -0,0 +1,70 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/wait.h>
+
+#include "include.hpp"
+
+// The servers the benchmarks start take this password
+#define BENCH_PASSWORD "bench"
+// How long a client waits for a line it needs before giving up
+#define BENCH_TIMEOUT_MS 10000
+
+namespace bench {
+
+uint64_t now_ns();
+// Results of the measured loops go here, so the work can't be optimized out
+extern volatile size_t sink;
+// A reproducible pseudo-random sequence from the state (xorshift32, not 0)
+uint32_t next_random(uint32_t &state);
+// Calls of operator new in this process so far
+size_t allocations();
+// One result as "bench: what value unit"
+void report(const char *bench, const std::string &what, double value,
+            const char *unit);
+// A checked limit was exceeded: ircbench exits with a failure
+void fail(const char *bench, const std::string &why);
+// The option "--name=value" from the command line, or the fallback
+size_t size_option(const std::string &name, size_t fallback);
+
+/**
+ * @brief Starts ./ircserv on the port. before_exec runs in the parent once
+ * the child exists but before the server starts, e.g. to attach a counter.
+ *
+ * @return the server's pid, -1 if it didn't come up
+ */
+pid_t start_server(int port, const std::vector<std::string> &options,
+                   void (*before_exec)(pid_t, void *), void *arg);
+void stop_server(pid_t pid);
+
+// A blocking connection from the source address (INADDR_ANY for any)
+int connect_client(int port, in_addr_t source);
+// Answers the PING and registers; false if the welcome didn't come
+bool register_client(int fd, const std::string &nick);
+// Reads until the data holds needle and the rest of its line, which goes
+// to line; false on timeout or EOF
+bool read_line_with(int fd, const std::string &needle, std::string &line);
+bool read_until(int fd, const std::string &needle);
+void send_line(int fd, const std::string &line);
+// Reads what arrives on the fds until lines more of them came in, or until
+// they were all quiet for 100 ms if lines is 0; false on timeout or EOF
+bool drain_lines(const std::vector<int> &fds, size_t lines);
+
+// A before_exec for start_server: arg is an int that gets a counter of the
+// server's syscalls, -1 if the tracepoint isn't there
+void attach_syscall_counter(pid_t pid, void *arg);
+uint64_t read_counter(int counter);
+
+// The benchmarks, see bench.cpp for the list
+void syscalls();
+void dispatch();
+void clients();
+void members();
+void names();
+void bytes();
+void wildcard();
+void replies();
+void timers();
+void loadtest();
+
+}  // namespace bench
@@ -0,0 +1,125 @@
+#include "bench.hpp"
+#include "kernels.hpp"
+#include "legacy.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BYTES_UNIT "bytes/cycle"
+#else
+#define BYTES_UNIT "bytes/ns"
+#endif
+
+// Input scanned per measurement, and how often
+#define BYTES_BUFFER 65536
+#define BYTES_PASSES 200
+// Channel names as long as JOIN allows
+#define BYTES_NAME_SIZE 200
+
+namespace bench {
+
+// The TSC where there is one, time otherwise
+static uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return now_ns();
+#endif
+}
+
+// Server::join_valid_channel_name_ before the kernels
+static bool legacy_valid_channel_name(const std::string &channel_name) {
+  size_t size = channel_name.size();
+  if (size > 1 && size <= 200 && (channel_name.at(0) == '#')) {
+    size_t i = 1;
+    while (i < size && channel_name.at(i) != ' ' &&
+           channel_name.at(i) != ',' && channel_name.at(i) != (char)7 &&
+           channel_name.at(i) != '#' && channel_name.at(i) != '&') {
+      ++i;
+    }
+    if (i == size) return true;
+  }
+  return false;
+}
+
+static bool valid_channel_name(const std::string &channel_name) {
+  size_t size = channel_name.size();
+  if (size <= 1 || size > 200 || channel_name[0] != '#') return false;
+  const char *end = channel_name.data() + size;
+  return irc::kernels.find_any_of(channel_name.data() + 1, end, " ,\a#&") ==
+         end;
+}
+
+static void report_bytes(const std::string &what, uint64_t legacy,
+                         uint64_t kernel, double bytes) {
+  report("bytes", what + ", old", bytes / legacy, BYTES_UNIT);
+  report("bytes", what + ", " + irc::kernels.name, bytes / kernel,
+         BYTES_UNIT);
+}
+
+/**
+ * @brief Throughput of the byte kernels the CPU got against the loops they
+ * replaced: the CRLF search over a read buffer of chat lines, comparing
+ * names case-insensitively, and checking channel names for the bytes JOIN
+ * rejects.
+ */
+void bytes() {
+  const char *line =
+      "PRIVMSG #lobby :did anyone look at the build from last night\r\n";
+  std::string buffer;
+  while (buffer.size() < BYTES_BUFFER) buffer += line;
+  size_t found = 0;
+
+  uint64_t started = cycles();
+  for (size_t pass = 0; pass < BYTES_PASSES; ++pass) {
+    size_t at = 0;
+    while ((at = buffer.find("\r\n", at)) != std::string::npos) {
+      ++found;
+      at += 2;
+    }
+  }
+  uint64_t legacy = cycles() - started;
+
+  started = cycles();
+  const char *end = buffer.data() + buffer.size();
+  for (size_t pass = 0; pass < BYTES_PASSES; ++pass) {
+    const char *at = buffer.data();
+    while ((at = irc::kernels.find_crlf(at, end))) {
+      ++found;
+      at += 2;
+    }
+  }
+  report_bytes("crlf search", legacy, cycles() - started,
+               (double)buffer.size() * BYTES_PASSES);
+
+  // The same name twice, once in the other case, so all bytes are compared
+  std::string name(BYTES_NAME_SIZE, 'a');
+  name[0] = '#';
+  for (size_t i = 1; i < name.size(); ++i) name[i] = "abcxyz[]\\-_"[i % 11];
+  std::string upper(name);
+  for (size_t i = 0; i < upper.size(); ++i)
+    if (upper[i] >= 'a' && upper[i] <= '~') upper[i] -= 0x20;
+  size_t rounds = BYTES_BUFFER * BYTES_PASSES / name.size();
+
+  started = cycles();
+  for (size_t i = 0; i < rounds; ++i)
+    found += legacy::irc_stringissame(name, upper);
+  legacy = cycles() - started;
+
+  started = cycles();
+  for (size_t i = 0; i < rounds; ++i)
+    found += irc::irc_stringissame(name, upper);
+  report_bytes("casefold compare", legacy, cycles() - started,
+               (double)name.size() * rounds);
+
+  started = cycles();
+  for (size_t i = 0; i < rounds; ++i) found += legacy_valid_channel_name(name);
+  legacy = cycles() - started;
+
+  started = cycles();
+  for (size_t i = 0; i < rounds; ++i) found += valid_channel_name(name);
+  report_bytes("channel name check", legacy, cycles() - started,
+               (double)name.size() * rounds);
+  sink += found;
+}
+
+}  // namespace bench
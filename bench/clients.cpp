@@ -0,0 +1,89 @@
+#include "ClientTable.hpp"
+#include "bench.hpp"
+
+// Connections in the tables, and lookups per measurement
+#define CLIENTS_COUNT 10000
+#define CLIENTS_LOOKUPS 2000000
+#define CLIENTS_CHURN 200000
+// The first fd a client gets, after the listeners, wake and spare fds
+#define CLIENTS_FIRST_FD 8
+
+namespace bench {
+
+static void fill_clients(std::map<int, irc::Client> &clients,
+                         irc::ClientTable &table) {
+  irc::Client client;
+  for (int fd = CLIENTS_FIRST_FD; fd < CLIENTS_FIRST_FD + CLIENTS_COUNT;
+       ++fd) {
+    clients.insert(std::make_pair(fd, client));
+    table.insert(fd, client);
+  }
+}
+
+/**
+ * @brief The old std::map<int, Client> against the ClientTable, with 10k
+ * connections: lookups of random fds, as every command does a few of them,
+ * a walk over all clients, and disconnects each followed by a connect that
+ * gets the same fd.
+ */
+void clients() {
+  std::map<int, irc::Client> clients;
+  irc::ClientTable table;
+  fill_clients(clients, table);
+
+  std::vector<int> order(CLIENTS_LOOKUPS);
+  uint32_t state = 1;
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = CLIENTS_FIRST_FD + next_random(state) % CLIENTS_COUNT;
+  size_t touched = 0;
+
+  uint64_t started = now_ns();
+  for (size_t i = 0; i < order.size(); ++i)
+    touched += clients.find(order[i])->second.get_reactor();
+  uint64_t map_ns = now_ns() - started;
+
+  started = now_ns();
+  for (size_t i = 0; i < order.size(); ++i)
+    touched += table.find(order[i])->get_reactor();
+  uint64_t table_ns = now_ns() - started;
+
+  report("clients", "lookup, map", (double)map_ns / order.size(), "ns");
+  report("clients", "lookup, table", (double)table_ns / order.size(), "ns");
+
+  started = now_ns();
+  for (std::map<int, irc::Client>::iterator it = clients.begin();
+       it != clients.end(); ++it)
+    touched += it->second.is_authorized();
+  map_ns = now_ns() - started;
+
+  started = now_ns();
+  const std::vector<int> &fds = table.fds();
+  for (size_t i = 0; i < fds.size(); ++i)
+    touched += table[fds[i]].is_authorized();
+  table_ns = now_ns() - started;
+
+  report("clients", "walk, map", (double)map_ns / CLIENTS_COUNT, "ns");
+  report("clients", "walk, table", (double)table_ns / CLIENTS_COUNT, "ns");
+
+  irc::Client client;
+  started = now_ns();
+  for (size_t i = 0; i < CLIENTS_CHURN; ++i) {
+    clients.erase(order[i]);
+    clients.insert(std::make_pair(order[i], client));
+  }
+  map_ns = now_ns() - started;
+
+  started = now_ns();
+  for (size_t i = 0; i < CLIENTS_CHURN; ++i) {
+    table.erase(order[i]);
+    table.insert(order[i], client);
+  }
+  table_ns = now_ns() - started;
+
+  report("clients", "reconnect, map", (double)map_ns / CLIENTS_CHURN, "ns");
+  report("clients", "reconnect, table", (double)table_ns / CLIENTS_CHURN,
+         "ns");
+  sink += touched;
+}
+
+}  // namespace bench
@@ -0,0 +1,127 @@
+#include "Server.hpp"
+#include "bench.hpp"
+#include "legacy.hpp"
+
+// Lines in the stream, and how much of it arrives per read
+#define DISPATCH_LINES 200000
+#define DISPATCH_READ_SIZE 4096
+
+namespace bench {
+
+// What a busy client sends, per 100 lines
+static const struct {
+  size_t weight;
+  const char *line;
+} command_mix[] = {
+    {55, "PRIVMSG #lobby :did anyone look at the build from last night"},
+    {5, "privmsg somebody :case doesn't matter for commands"},
+    {10, "PING :ft_irc"},
+    {5, "PONG :1700000000"},
+    {5, "NOTICE #lobby :heads up"},
+    {5, "JOIN #lobby,#dev"},
+    {3, "PART #dev :later"},
+    {4, "MODE #lobby +v somebody"},
+    {2, "NICK somebody_else"},
+    {2, "TOPIC #lobby :release on friday"},
+    {2, "WHO #lobby"},
+    {1, ":somebody!user@host KICK #lobby troll :bye"},
+    {1, "CAP LS 302"},
+};
+
+// The authorized list of the old Server::functions_, in its order
+static const char *legacy_commands[] = {
+    "PASS", "USER", "NICK", "PONG", "PING", "QUIT", "PRIVMSG",
+    "LUSERS", "OPER", "MODE", "KILL", "JOIN", "NOTICE", "INVITE",
+    "KICK", "TOPIC", "PART"};
+
+static std::string command_stream() {
+  std::string stream;
+  size_t lines = 0;
+  while (lines < DISPATCH_LINES) {
+    for (size_t i = 0; i < sizeof(command_mix) / sizeof(command_mix[0]); ++i)
+      for (size_t j = 0; j < command_mix[i].weight; ++j, ++lines)
+        stream.append(command_mix[i].line).append("\r\n");
+  }
+  return stream;
+}
+
+static int legacy_dispatch(const std::vector<std::string> &names,
+                           const std::string &command) {
+  for (size_t i = 0; i < names.size(); ++i)
+    if (legacy::irc_stringissame(names[i], command)) return i;
+  return -1;
+}
+
+/**
+ * @brief Lines read in 4 KiB chunks, split and resolved to their handler:
+ * the old string buffer with get_next_message_ and the linear scan over
+ * Server::functions_, against InputBuffer::parse() and the command table.
+ * Then the lookup alone, on names already split.
+ */
+void dispatch() {
+  std::string stream = command_stream();
+  std::vector<std::string> names(
+      legacy_commands,
+      legacy_commands + sizeof(legacy_commands) / sizeof(legacy_commands[0]));
+  irc::Server server;
+  size_t found = 0;
+  size_t lines = 0;
+
+  uint64_t started = now_ns();
+  std::string buffer;
+  for (size_t at = 0; at < stream.size(); at += DISPATCH_READ_SIZE) {
+    buffer.append(stream, at, DISPATCH_READ_SIZE);
+    std::vector<std::string> message = legacy::get_next_message(buffer);
+    while (!message.empty()) {
+      found += legacy_dispatch(names, message[0]) >= 0;
+      ++lines;
+      message = legacy::get_next_message(buffer);
+    }
+  }
+  uint64_t legacy_ns = now_ns() - started;
+
+  started = now_ns();
+  irc::InputBuffer input;
+  irc::message_view message;
+  for (size_t at = 0; at < stream.size(); at += DISPATCH_READ_SIZE) {
+    input.append(stream.data() + at,
+                 std::min((size_t)DISPATCH_READ_SIZE, stream.size() - at));
+    input.parse();
+    while (input.next_message(message))
+      found += server.find_command(message.command) != NULL;
+  }
+  uint64_t table_ns = now_ns() - started;
+
+  report("dispatch", "parse and lookup, old", (double)legacy_ns / lines, "ns");
+  report("dispatch", "parse and lookup, new", (double)table_ns / lines, "ns");
+
+  // The command names of the mix, split beforehand
+  std::vector<std::string> commands;
+  for (size_t at = 0; at < stream.size();) {
+    size_t end = stream.find("\r\n", at);
+    std::string line(stream, at, end - at);
+    if (line[0] == ':') line.erase(0, line.find(' ') + 1);
+    commands.push_back(line.substr(0, line.find(' ')));
+    at = end + 2;
+  }
+
+  started = now_ns();
+  for (size_t i = 0; i < commands.size(); ++i)
+    found += legacy_dispatch(names, commands[i]) >= 0;
+  legacy_ns = now_ns() - started;
+
+  started = now_ns();
+  for (size_t i = 0; i < commands.size(); ++i) {
+    irc::slice name = {commands[i].data(), commands[i].size()};
+    found += server.find_command(name) != NULL;
+  }
+  table_ns = now_ns() - started;
+
+  report("dispatch", "lookup only, old", (double)legacy_ns / commands.size(),
+         "ns");
+  report("dispatch", "lookup only, new", (double)table_ns / commands.size(),
+         "ns");
+  sink += found;
+}
+
+}  // namespace bench
@@ -0,0 +1,100 @@
+#include "legacy.hpp"
+
+namespace bench {
+namespace legacy {
+
+bool irc_charissame(char a, char b) {
+  if (a == b) return true;
+  if ((a == '[' || a == '{') && (b == '[' || b == '{'))
+    return true;
+  else if ((a == ']' || a == '}') && (b == ']' || b == '}'))
+    return true;
+  else if ((a == '\\' || a == '|') && (b == '\\' || b == '|'))
+    return true;
+  else if (isupper(a) && islower(b) && a == b - 32)
+    return true;
+  else if (isupper(b) && islower(a) && b == a - 32)
+    return true;
+  return false;
+}
+
+bool irc_stringissame(const std::string &str1, const std::string &str2) {
+  if (str1.size() != str2.size()) return false;
+  for (size_t i = 0; i < str1.size(); ++i) {
+    if (!irc_charissame(str1.at(i), str2.at(i))) return false;
+  }
+  return true;
+}
+
+bool irc_customlesscomparator(const char *str1, const char *str2) {
+  int i = 0;
+  while (str1[i] != '\0' && str2[i] != '\0') {
+    if (!irc_charissame(str1[i], str2[i])) {
+      return (str1[i] < str2[i]) ? true : false;
+    }
+    i++;
+  }
+  return (str1[i] == '\0' && str2[i] == '\0')
+             ? false
+             : ((str1[i] == '\0') ? true : false);
+}
+
+bool irc_wildcard_cmp(const char *string, const char *mask) {
+  while (*string && *mask) {
+    if (irc_charissame(*mask, *string) || *mask == '?') {
+      mask++;
+      string++;
+    } else if (*mask == '*') {
+      while (*mask == '*') {
+        mask++;
+      }
+      if (*mask == '\0') {
+        return true;
+      }
+      while (*string) {
+        if (irc_wildcard_cmp(string, mask)) {
+          return true;
+        }
+        string++;
+      }
+      return false;
+    } else {
+      return false;
+    }
+  }
+  return ((*mask == '*' || *mask == '\0') && *string == '\0');
+}
+
+std::vector<std::string> get_next_message(std::string &buffer) {
+  std::vector<std::string> ret;
+  size_t end_of_message = buffer.find("\r\n");
+
+  if (end_of_message == std::string::npos) return ret;
+
+  std::string message = buffer.substr(0, end_of_message);
+  buffer.erase(0, end_of_message + 2);
+
+  size_t pos;
+  if (message.size() && message.at(0) == ':' &&
+      (pos = message.find(" ")) != std::string::npos)
+    message.erase(0, pos + 1);
+
+  if (message.size() && message.at(0) == ':') {
+    ret.push_back(message.substr(1, message.size() - 1));
+    return ret;
+  }
+  while ((pos = message.find(" ")) != std::string::npos) {
+    if (pos > 0) ret.push_back(message.substr(0, pos));
+    message.erase(0, pos + 1);
+    if (message.size() && message.at(0) == ':') {
+      ret.push_back(message.substr(1, message.size() - 1));
+      return ret;
+    }
+  }
+
+  if (!message.empty()) ret.push_back(message);
+  return ret;
+}
+
+}  // namespace legacy
+}  // namespace bench
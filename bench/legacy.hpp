@@ -0,0 +1,30 @@
+#pragma once
+
+#include "include.hpp"
+
+namespace bench {
+
+/**
+ * Helpers as they were before their rewrites, kept as the baselines of the
+ * benchmarks.
+ */
+namespace legacy {
+
+bool irc_charissame(char a, char b);
+bool irc_stringissame(const std::string &str1, const std::string &str2);
+bool irc_customlesscomparator(const char *str1, const char *str2);
+// The recursive matcher of Channel::is_banned, exponential on "*a*a*a*b"
+bool irc_wildcard_cmp(const char *string, const char *mask);
+// Server::get_next_message_: cuts the first line off the buffer and splits
+// it, the prefix dropped; empty if there is no complete line
+std::vector<std::string> get_next_message(std::string &buffer);
+
+// The order of the old channels_ and map_name_fd_ maps
+struct irc_stringmapcomparator {
+  bool operator()(const std::string &lhs, const std::string &rhs) const {
+    return irc_customlesscomparator(lhs.c_str(), rhs.c_str());
+  }
+};
+
+}  // namespace legacy
+}  // namespace bench
@@ -0,0 +1,142 @@
+#include "bench.hpp"
+
+#define LOADTEST_PORT 16703
+#define LOADTEST_CONNECTIONS 100000
+// Growth of the server's resident memory allowed per idle connection
+#define LOADTEST_RSS_PER_CONNECTION 8192
+// Connections per source address: connect() searches the ephemeral ports
+// for one that is free, which slows down as a source fills its range
+#define LOADTEST_PER_SOURCE 1000
+
+namespace bench {
+
+// Resident memory of the process in bytes, 0 if it can't be read
+static size_t resident_bytes(pid_t pid) {
+  std::ostringstream path;
+  path << "/proc/" << pid << "/status";
+  std::ifstream status(path.str().c_str());
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0)
+      return strtoul(line.c_str() + 6, NULL, 10) * 1024;
+  }
+  return 0;
+}
+
+// Room for the connections in this process; the server raises its own
+static bool raise_fd_limit(size_t connections) {
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) < 0) return false;
+  limit.rlim_cur = limit.rlim_max;
+  if (setrlimit(RLIMIT_NOFILE, &limit) < 0) return false;
+  return limit.rlim_cur == RLIM_INFINITY || connections + 64 <= limit.rlim_cur;
+}
+
+// Closes with a reset, so reruns don't find the ports in TIME_WAIT
+static void reset_connections(std::vector<int> &fds) {
+  struct linger abort_close;
+  abort_close.l_onoff = 1;
+  abort_close.l_linger = 0;
+  for (size_t i = 0; i < fds.size(); ++i) {
+    setsockopt(fds[i], SOL_SOCKET, SO_LINGER, &abort_close,
+               sizeof(abort_close));
+    close(fds[i]);
+  }
+  fds.clear();
+}
+
+// Are all clients still there, and did the memory stay within the budget?
+static void check_server(pid_t server, int fd, size_t connections,
+                         size_t rss_before, size_t budget) {
+  send_line(fd, "LUSERS");
+  std::string line;
+  size_t users = 0;
+  if (read_line_with(fd, " 251 ", line)) {
+    size_t pos = line.find(":There are ");
+    if (pos != std::string::npos)
+      users = strtoul(line.c_str() + pos + 11, NULL, 10);
+  }
+  if (users != connections) {
+    std::ostringstream why;
+    why << "LUSERS counts " << users << " users, not " << connections;
+    fail("loadtest", why.str());
+  }
+
+  size_t rss = resident_bytes(server);
+  double per_connection =
+      rss > rss_before ? (double)(rss - rss_before) / connections : 0;
+  report("loadtest", "server rss", rss / 1048576.0, "MiB");
+  report("loadtest", "rss per connection", per_connection, "bytes");
+  if (per_connection > budget) {
+    std::ostringstream why;
+    why << "rss grew by " << per_connection << " bytes per connection, over "
+        << budget;
+    fail("loadtest", why.str());
+  }
+}
+
+/**
+ * @brief Opens --connections registered clients (100k by default) from
+ * several 127.0.0.x addresses and leaves them idle. Fails unless the server
+ * counts them all in LUSERS and its resident memory grew by at most
+ * --rss-per-connection bytes (8 KiB by default) per connection.
+ *
+ * Both this process and the server need a hard fd limit above the number
+ * of connections. Keepalive PINGs are turned off for the run, registering
+ * 100k clients one after the other takes longer than the ping interval.
+ */
+void loadtest() {
+  size_t connections = size_option("connections", LOADTEST_CONNECTIONS);
+  size_t budget =
+      size_option("rss-per-connection", LOADTEST_RSS_PER_CONNECTION);
+  if (!raise_fd_limit(connections)) {
+    fail("loadtest", "the hard fd limit is too low, raise ulimit -Hn");
+    return;
+  }
+
+  std::ostringstream max_clients;
+  max_clients << "--max-clients=" << connections;
+  std::vector<std::string> options;
+  options.push_back(max_clients.str());
+  options.push_back("--resolver-threads=0");
+  options.push_back("--ping-interval=86400");
+  pid_t server = start_server(LOADTEST_PORT, options, NULL, NULL);
+  if (server < 0) {
+    fail("loadtest", "the server didn't start");
+    return;
+  }
+  size_t rss_before = resident_bytes(server);
+
+  std::vector<int> fds;
+  size_t registered = 0;
+  uint64_t started = now_ns();
+  while (registered < connections) {
+    in_addr_t source =
+        htonl(INADDR_LOOPBACK + 1 + registered / LOADTEST_PER_SOURCE);
+    int fd = connect_client(LOADTEST_PORT, source);
+    if (fd < 0) break;
+    fds.push_back(fd);
+    std::ostringstream nick;
+    nick << "load" << registered;
+    if (!register_client(fd, nick.str())) break;
+    ++registered;
+  }
+  uint64_t elapsed = now_ns() - started;
+  // The rest of the welcome bursts
+  drain_lines(fds, 0);
+
+  if (registered < connections) {
+    std::ostringstream why;
+    why << "only " << registered << " of " << connections
+        << " clients registered";
+    fail("loadtest", why.str());
+  } else {
+    report("loadtest", "registration", elapsed / 1000.0 / connections,
+           "us per client");
+    check_server(server, fds.back(), connections, rss_before, budget);
+  }
+  reset_connections(fds);
+  stop_server(server);
+}
+
+}  // namespace bench
@@ -0,0 +1,111 @@
+#include "MemberTable.hpp"
+#include "bench.hpp"
+#include "legacy.hpp"
+
+// Lookups per channel size, and JOIN/PART pairs
+#define MEMBERS_LOOKUPS 200000
+#define MEMBERS_JOINS 20000
+
+namespace bench {
+
+// The members of the old Channel: nicknames, the +o and +v ones in sets
+struct legacy_channel {
+  std::vector<std::string> users;
+  std::set<std::string> operators;
+  std::set<std::string> speakers;
+
+  bool is_user(const std::string &nick) const {
+    for (size_t i = 0; i < users.size(); ++i)
+      if (legacy::irc_stringissame(nick, users[i])) return true;
+    return false;
+  }
+
+  void remove_user(const std::string &nick) {
+    if (operators.find(nick) != operators.end()) operators.erase(nick);
+    if (speakers.find(nick) != speakers.end()) speakers.erase(nick);
+    for (std::vector<std::string>::iterator it = users.begin();
+         it != users.end(); ++it) {
+      if (legacy::irc_stringissame(nick, *it)) {
+        users.erase(it);
+        return;
+      }
+    }
+  }
+};
+
+static std::string member_nick(size_t i) {
+  std::ostringstream nick;
+  nick << "member" << i;
+  return nick.str();
+}
+
+/**
+ * @brief Channels of a size, in the old layout and as a MemberTable: is
+ * this client a member, as PRIVMSG and MODE ask, and a JOIN (the member
+ * check, then the insert) followed by a PART of a client not in it yet.
+ * The old channel knows its members by nickname, the table by client id.
+ */
+static void measure_channel(size_t size) {
+  legacy_channel channel;
+  irc::MemberTable table;
+  std::vector<std::string> nicks;
+  for (size_t i = 0; i < size; ++i) {
+    nicks.push_back(member_nick(i));
+    channel.users.push_back(nicks.back());
+    table.insert(i, 0);
+  }
+  std::vector<size_t> order(MEMBERS_LOOKUPS);
+  uint32_t state = 7;
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = next_random(state) % size;
+
+  // Fewer rounds for the old layout on large channels, it is O(members)
+  size_t rounds = std::min((size_t)MEMBERS_LOOKUPS, 20000000 / size);
+  size_t found = 0;
+  uint64_t started = now_ns();
+  for (size_t i = 0; i < rounds; ++i)
+    found += channel.is_user(nicks[order[i]]);
+  uint64_t legacy_ns = now_ns() - started;
+
+  started = now_ns();
+  for (size_t i = 0; i < order.size(); ++i)
+    found += table.find(order[i]) != NULL;
+  uint64_t table_ns = now_ns() - started;
+
+  std::ostringstream what;
+  what << size << " members, ";
+  report("members", what.str() + "lookup, old", (double)legacy_ns / rounds,
+         "ns");
+  report("members", what.str() + "lookup, new",
+         (double)table_ns / order.size(), "ns");
+
+  std::string joining = member_nick(size);
+  rounds = std::min((size_t)MEMBERS_JOINS, 2000000 / size);
+  started = now_ns();
+  for (size_t i = 0; i < rounds; ++i) {
+    if (!channel.is_user(joining)) channel.users.push_back(joining);
+    channel.remove_user(joining);
+  }
+  legacy_ns = now_ns() - started;
+
+  started = now_ns();
+  for (size_t i = 0; i < MEMBERS_JOINS; ++i) {
+    if (!table.find(size)) table.insert(size, 0);
+    table.erase(size);
+  }
+  table_ns = now_ns() - started;
+
+  report("members", what.str() + "join and part, old",
+         (double)legacy_ns / rounds, "ns");
+  report("members", what.str() + "join and part, new",
+         (double)table_ns / MEMBERS_JOINS, "ns");
+  sink += found;
+}
+
+void members() {
+  measure_channel(10);
+  measure_channel(1000);
+  measure_channel(10000);
+}
+
+}  // namespace bench
@@ -0,0 +1,99 @@
+#include "NameRegistry.hpp"
+#include "bench.hpp"
+#include "legacy.hpp"
+
+#define NAMES_NICKS 100000
+#define NAMES_CHANNELS 50000
+#define NAMES_LOOKUPS 1000000
+#define NAMES_RENAMES 200000
+
+namespace bench {
+
+typedef std::map<std::string, int, legacy::irc_stringmapcomparator>
+    legacy_registry;
+
+// How a client may write a name: the case and the brackets swapped
+static std::string other_case(const std::string &name) {
+  std::string swapped(name);
+  for (size_t i = 0; i < swapped.size(); ++i) {
+    char c = swapped[i];
+    if (isalpha(c))
+      swapped[i] = c ^ 0x20;
+    else if (c == '[' || c == ']' || c == '\\')
+      swapped[i] = c + 0x20;
+  }
+  return swapped;
+}
+
+/**
+ * @brief One registry in the old map with its casemapping comparator and as
+ * a NameRegistry: lookups of known names written in another case, lookups
+ * of unknown ones, and renames (erase and insert) as NICK does.
+ */
+static void measure_registry(const char *what, const char *prefix,
+                             size_t count) {
+  legacy_registry map;
+  irc::NameRegistry<int> registry;
+  std::vector<std::string> names;
+  for (size_t i = 0; i < count; ++i) {
+    std::ostringstream name;
+    name << prefix << "[dev]" << i;
+    names.push_back(name.str());
+    map.insert(std::make_pair(names.back(), (int)i));
+    registry.insert(names.back(), (int)i);
+  }
+
+  std::vector<std::string> queries;
+  uint32_t state = 11;
+  for (size_t i = 0; i < NAMES_LOOKUPS; ++i) {
+    std::string name = names[next_random(state) % count];
+    // Every fourth lookup misses
+    queries.push_back(i % 4 == 3 ? name + "_" : other_case(name));
+  }
+  size_t found = 0;
+
+  uint64_t started = now_ns();
+  for (size_t i = 0; i < queries.size(); ++i)
+    found += map.find(queries[i]) != map.end();
+  uint64_t map_ns = now_ns() - started;
+
+  started = now_ns();
+  for (size_t i = 0; i < queries.size(); ++i)
+    found += registry.find(queries[i]) != NULL;
+  uint64_t registry_ns = now_ns() - started;
+
+  std::string label(what);
+  report("names", label + " lookup, map", (double)map_ns / queries.size(),
+         "ns");
+  report("names", label + " lookup, registry",
+         (double)registry_ns / queries.size(), "ns");
+
+  started = now_ns();
+  for (size_t i = 0; i < NAMES_RENAMES; ++i) {
+    const std::string &name = names[i % count];
+    map.erase(name);
+    map.insert(std::make_pair(name, (int)i));
+  }
+  map_ns = now_ns() - started;
+
+  started = now_ns();
+  for (size_t i = 0; i < NAMES_RENAMES; ++i) {
+    const std::string &name = names[i % count];
+    registry.erase(name);
+    registry.insert(name, (int)i);
+  }
+  registry_ns = now_ns() - started;
+
+  report("names", label + " rename, map", (double)map_ns / NAMES_RENAMES,
+         "ns");
+  report("names", label + " rename, registry",
+         (double)registry_ns / NAMES_RENAMES, "ns");
+  sink += found;
+}
+
+void names() {
+  measure_registry("100k nicks", "nick", NAMES_NICKS);
+  measure_registry("50k channels", "#chan", NAMES_CHANNELS);
+}
+
+}  // namespace bench
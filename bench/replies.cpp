@@ -0,0 +1,115 @@
+#include "ReplyBuilder.hpp"
+#include "bench.hpp"
+
+#define REPLIES_ROUNDS 200000
+// Recipients of the channel message, and how many messages go out
+#define REPLIES_MEMBERS 1000
+#define REPLIES_MESSAGES 200
+
+namespace bench {
+
+// Server::numeric_reply_ before the reply builder, queued as a string
+static void legacy_numeric_reply(irc::SendQueue &queue, int error_number,
+                                 const std::string &nickname,
+                                 std::map<int, std::string> &error_codes,
+                                 std::string argument) {
+  std::ostringstream ss;
+  ss << ":" << "ft_irc" << " " << error_number << " " << nickname;
+
+  if (argument.size()) ss << " ";
+
+  ss << argument << " " << error_codes[error_number];
+  queue.push(ss.str() + "\r\n");
+}
+
+static void drain(irc::Client &client) {
+  irc::SendQueue &queue = client.get_send_queue();
+  queue.consume(queue.size());
+}
+
+/**
+ * @brief Heap allocations and time of a numeric reply (401 to an unknown
+ * nickname), from the old stringstream formatting and the ReplyBuilder,
+ * and of a channel message handed to 1000 members: a copy per member as
+ * before the shared buffers, and one buffer they all reference. The queues
+ * are drained like a completed send after each reply or message.
+ */
+void replies() {
+  irc::Client client;
+  client.set_nickname("visitor");
+  client.set_reply_prefix("ft_irc");
+  std::map<int, std::string> error_codes;
+  error_codes[401] = ":No such nick/channel";
+  std::string target("nobody");
+  // Fills the block pool and the queue's deque before counting
+  for (size_t i = 0; i < 1000; ++i) {
+    irc::ReplyBuilder(client, 401) << target << " :No such nick/channel";
+    drain(client);
+  }
+
+  size_t counted = allocations();
+  uint64_t started = now_ns();
+  for (size_t i = 0; i < REPLIES_ROUNDS; ++i) {
+    legacy_numeric_reply(client.get_send_queue(), 401,
+                         client.get_nickname(), error_codes, target);
+    drain(client);
+  }
+  uint64_t legacy_ns = now_ns() - started;
+  size_t legacy_allocations = allocations() - counted;
+
+  counted = allocations();
+  started = now_ns();
+  for (size_t i = 0; i < REPLIES_ROUNDS; ++i) {
+    irc::ReplyBuilder reply(client, 401);
+    reply << target << " :No such nick/channel";
+    reply.send();
+    drain(client);
+  }
+  uint64_t builder_ns = now_ns() - started;
+  size_t builder_allocations = allocations() - counted;
+
+  report("replies", "numeric, stringstream", (double)legacy_ns / REPLIES_ROUNDS,
+         "ns");
+  report("replies", "numeric, builder", (double)builder_ns / REPLIES_ROUNDS,
+         "ns");
+  report("replies", "numeric allocations, stringstream",
+         (double)legacy_allocations / REPLIES_ROUNDS, "per reply");
+  report("replies", "numeric allocations, builder",
+         (double)builder_allocations / REPLIES_ROUNDS, "per reply");
+
+  std::vector<irc::Client> members(REPLIES_MEMBERS);
+  std::string message(":visitor!~user@client-42.dsl.example.org PRIVMSG "
+                      "#lobby :did anyone look at the build\r\n");
+  size_t deliveries = (size_t)REPLIES_MEMBERS * REPLIES_MESSAGES;
+
+  counted = allocations();
+  started = now_ns();
+  for (size_t round = 0; round < REPLIES_MESSAGES; ++round) {
+    for (size_t i = 0; i < members.size(); ++i)
+      members[i].get_send_queue().push(message);
+    for (size_t i = 0; i < members.size(); ++i) drain(members[i]);
+  }
+  legacy_ns = now_ns() - started;
+  legacy_allocations = allocations() - counted;
+
+  counted = allocations();
+  started = now_ns();
+  for (size_t round = 0; round < REPLIES_MESSAGES; ++round) {
+    irc::SharedBuffer shared(message);
+    for (size_t i = 0; i < members.size(); ++i)
+      members[i].get_send_queue().push(shared);
+    for (size_t i = 0; i < members.size(); ++i) drain(members[i]);
+  }
+  builder_ns = now_ns() - started;
+  builder_allocations = allocations() - counted;
+
+  report("replies", "fanout, copy per member", (double)legacy_ns / deliveries,
+         "ns");
+  report("replies", "fanout, shared", (double)builder_ns / deliveries, "ns");
+  report("replies", "fanout allocations, copy per member",
+         (double)legacy_allocations / deliveries, "per member");
+  report("replies", "fanout allocations, shared",
+         (double)builder_allocations / deliveries, "per member");
+}
+
+}  // namespace bench
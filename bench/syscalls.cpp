@@ -0,0 +1,126 @@
+#include "bench.hpp"
+
+// Clients in the channel, and rounds of one line from each of them
+#define SYSCALLS_CLIENTS 20
+#define SYSCALLS_ROUNDS 500
+#define SYSCALLS_PORT 16700
+
+namespace bench {
+
+static const char *tracepoint_ids[] = {
+    "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+    "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"};
+
+/**
+ * @brief Opens a counter of the raw_syscalls:sys_enter tracepoint on the
+ * process, inherited by the threads it starts and enabled once it exec()s.
+ * Needs tracefs and a low enough perf_event_paranoid (or root).
+ */
+void attach_syscall_counter(pid_t pid, void *arg) {
+  int *counter = static_cast<int *>(arg);
+  *counter = -1;
+  uint64_t id = 0;
+  for (size_t i = 0; i < 2 && !id; ++i) {
+    std::ifstream file(tracepoint_ids[i]);
+    file >> id;
+  }
+  if (!id) return;
+
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_TRACEPOINT;
+  attr.size = sizeof(attr);
+  attr.config = id;
+  attr.disabled = 1;
+  attr.enable_on_exec = 1;
+  attr.inherit = 1;
+  *counter = syscall(__NR_perf_event_open, &attr, pid, -1, -1,
+                     PERF_FLAG_FD_CLOEXEC);
+}
+
+uint64_t read_counter(int counter) {
+  uint64_t count = 0;
+  if (read(counter, &count, sizeof(count)) != sizeof(count)) return 0;
+  return count;
+}
+
+/**
+ * @brief Syscalls the server makes per message, for one backend. Every
+ * client says one line to the channel per round and the round ends once the
+ * others got it, so the server is never handed a large batch.
+ */
+static void count_syscalls(const char *backend, int port) {
+  std::vector<std::string> options;
+  options.push_back(std::string("--event-backend=") + backend);
+  options.push_back("--flood-interval=0");
+  options.push_back("--resolver-threads=0");
+  int counter = -1;
+  pid_t server = start_server(port, options, &attach_syscall_counter, &counter);
+  if (server < 0) {
+    std::cout << "syscalls: " << backend << " server didn't start"
+              << std::endl;
+    if (counter >= 0) close(counter);
+    return;
+  }
+  if (counter < 0) {
+    std::cout << "syscalls: no raw_syscalls tracepoint (mount tracefs, run "
+                 "as root)"
+              << std::endl;
+    stop_server(server);
+    return;
+  }
+
+  std::vector<int> fds;
+  for (size_t i = 0; i < SYSCALLS_CLIENTS; ++i) {
+    std::ostringstream nick;
+    nick << "bench" << i;
+    int fd = connect_client(port, INADDR_ANY);
+    if (fd < 0 || !register_client(fd, nick.str())) {
+      std::cout << "syscalls: registration failed" << std::endl;
+      if (fd >= 0) close(fd);
+      break;
+    }
+    send_line(fd, "JOIN #bench");
+    read_until(fd, " 366 ");
+    fds.push_back(fd);
+  }
+  // The JOINs of the later clients went to the earlier ones
+  usleep(200000);
+  drain_lines(fds, 0);
+
+  if (fds.size() == SYSCALLS_CLIENTS) {
+    size_t deliveries = SYSCALLS_CLIENTS - 1;
+    uint64_t before = read_counter(counter);
+    uint64_t started = now_ns();
+    bool complete = true;
+    for (size_t round = 0; round < SYSCALLS_ROUNDS && complete; ++round) {
+      for (size_t i = 0; i < fds.size(); ++i)
+        send_line(fds[i], "PRIVMSG #bench :one line of benchmark chatter");
+      complete = drain_lines(fds, fds.size() * deliveries);
+    }
+    uint64_t elapsed = now_ns() - started;
+    uint64_t calls = read_counter(counter) - before;
+
+    if (!complete) {
+      std::cout << "syscalls: " << backend << " lost messages" << std::endl;
+    } else {
+      double lines = (double)SYSCALLS_CLIENTS * SYSCALLS_ROUNDS;
+      report("syscalls", std::string(backend) + " per line received",
+             calls / lines, "syscalls");
+      report("syscalls", std::string(backend) + " per line delivered",
+             calls / (lines * deliveries), "syscalls");
+      report("syscalls", std::string(backend) + " round trip",
+             elapsed / 1000.0 / SYSCALLS_ROUNDS, "us");
+    }
+  }
+  for (size_t i = 0; i < fds.size(); ++i) close(fds[i]);
+  close(counter);
+  stop_server(server);
+}
+
+void syscalls() {
+  count_syscalls("epoll", SYSCALLS_PORT);
+  count_syscalls("io_uring", SYSCALLS_PORT + 1);
+}
+
+}  // namespace bench
@@ -0,0 +1,135 @@
+#include "TimerWheel.hpp"
+#include "bench.hpp"
+
+// Connections with a deadline, and loop iterations measured
+#define TIMERS_CONNECTIONS 10000
+#define TIMERS_ITERATIONS 1000
+// PONGs, each moving a connection's deadline
+#define TIMERS_REARMS 1000000
+// Clients of the idle server, and how long it is watched
+#define TIMERS_IDLE_CLIENTS 50
+#define TIMERS_IDLE_MS 5000
+#define TIMERS_PORT 16702
+
+namespace bench {
+
+/**
+ * @brief The old Server::check_open_ping_responses_ when nothing is due: a
+ * walk over every connection awaiting a PONG, with a client lookup and a
+ * time() call per entry.
+ */
+static size_t legacy_check_pings(std::set<int> &open_ping_responses,
+                                 std::map<int, irc::Client> &clients) {
+  size_t due = 0;
+  std::set<int>::iterator it = open_ping_responses.begin();
+  std::set<int>::iterator end = open_ping_responses.end();
+  while (it != end) {
+    irc::Client &client = clients[*it];
+    if (client.get_ping_status())
+      open_ping_responses.erase(it++);
+    else if (time(NULL) - client.get_ping_time() > 60)
+      ++due, ++it;
+    else
+      ++it;
+  }
+  return due;
+}
+
+static void measure_loop_cost() {
+  std::set<int> open_ping_responses;
+  std::map<int, irc::Client> clients;
+  irc::TimerWheel wheel(1);
+  // Pinged and not answered yet
+  irc::Client client;
+  client.set_new_ping();
+  for (int fd = 0; fd < TIMERS_CONNECTIONS; ++fd) {
+    open_ping_responses.insert(fd);
+    clients.insert(std::make_pair(fd, client));
+    wheel.arm(1 + 60 + fd % 60, fd);
+  }
+  size_t due = 0;
+
+  uint64_t started = now_ns();
+  for (size_t i = 0; i < TIMERS_ITERATIONS; ++i)
+    due += legacy_check_pings(open_ping_responses, clients);
+  uint64_t legacy_ns = now_ns() - started;
+
+  // One iteration per tick here, the server runs far fewer
+  std::vector<irc::client_id> expired;
+  started = now_ns();
+  for (size_t i = 0; i < TIMERS_ITERATIONS; ++i) {
+    wheel.advance(1 + i % 60, expired);
+    due += expired.size();
+  }
+  uint64_t wheel_ns = now_ns() - started;
+
+  report("timers", "loop iteration, ping set walk",
+         (double)legacy_ns / TIMERS_ITERATIONS, "ns");
+  report("timers", "loop iteration, wheel",
+         (double)wheel_ns / TIMERS_ITERATIONS, "ns");
+
+  std::vector<irc::timer_handle> handles(TIMERS_CONNECTIONS);
+  irc::TimerWheel rearmed(0);
+  for (size_t i = 0; i < handles.size(); ++i)
+    handles[i] = rearmed.arm(120, i);
+  uint32_t state = 3;
+  started = now_ns();
+  for (size_t i = 0; i < TIMERS_REARMS; ++i) {
+    size_t id = next_random(state) % TIMERS_CONNECTIONS;
+    rearmed.cancel(handles[id]);
+    handles[id] = rearmed.arm(120 + i % 4000, id);
+  }
+  wheel_ns = now_ns() - started;
+
+  report("timers", "rearm, wheel", (double)wheel_ns / TIMERS_REARMS, "ns");
+  sink += due;
+}
+
+/**
+ * @brief Syscalls per second of a server whose clients are all idle. The
+ * old loop woke from a 100 ms epoll_wait timeout ten times a second to
+ * check the pings; now it sleeps until the next deadline.
+ */
+static void measure_idle_wakeups() {
+  std::vector<std::string> options;
+  options.push_back("--resolver-threads=0");
+  int counter = -1;
+  pid_t server =
+      start_server(TIMERS_PORT, options, &attach_syscall_counter, &counter);
+  if (server < 0 || counter < 0) {
+    std::cout << "timers: no server or no syscall counter" << std::endl;
+    if (counter >= 0) close(counter);
+    if (server >= 0) stop_server(server);
+    return;
+  }
+
+  std::vector<int> fds;
+  for (size_t i = 0; i < TIMERS_IDLE_CLIENTS; ++i) {
+    std::ostringstream nick;
+    nick << "idle" << i;
+    int fd = connect_client(TIMERS_PORT, INADDR_ANY);
+    if (fd < 0) break;
+    fds.push_back(fd);
+    if (!register_client(fd, nick.str())) break;
+  }
+  if (fds.size() == TIMERS_IDLE_CLIENTS) {
+    usleep(200000);
+    uint64_t before = read_counter(counter);
+    usleep(TIMERS_IDLE_MS * 1000);
+    uint64_t calls = read_counter(counter) - before;
+    report("timers", "idle server", calls * 1000.0 / TIMERS_IDLE_MS,
+           "syscalls/s");
+  } else {
+    std::cout << "timers: registration failed" << std::endl;
+  }
+  for (size_t i = 0; i < fds.size(); ++i) close(fds[i]);
+  close(counter);
+  stop_server(server);
+}
+
+void timers() {
+  measure_loop_cost();
+  measure_idle_wakeups();
+}
+
+}  // namespace bench
@@ -0,0 +1,188 @@
+#include "BanList.hpp"
+
+namespace irc {
+
+BanList::BanList()
+    : masks_(), compiled_(), index_(), unindexed_(), epoch_(1) {}
+
+BanList::BanList(const BanList &other)
+    : masks_(other.masks_),
+      compiled_(other.compiled_),
+      index_(other.index_),
+      unindexed_(other.unindexed_),
+      epoch_(other.epoch_) {}
+
+BanList &BanList::operator=(const BanList &other) {
+  if (this != &other) {
+    masks_ = other.masks_;
+    compiled_ = other.compiled_;
+    index_ = other.index_;
+    unindexed_ = other.unindexed_;
+    epoch_ = other.epoch_;
+  }
+  return *this;
+}
+
+BanList::~BanList() {}
+
+BanList::compiled_ban BanList::compile_(const banmask &mask) {
+  compiled_ban ban;
+  ban.nickname = WildcardMask(mask.banned_nickname);
+  ban.username = WildcardMask(mask.banned_username);
+  ban.hostname = WildcardMask(mask.banned_hostname);
+  return ban;
+}
+
+bool BanList::compiled_matches_(const compiled_ban &ban,
+                                const std::string &nickname,
+                                const std::string &username,
+                                const std::string &hostname) {
+  return ban.nickname.matches(nickname) && ban.username.matches(username) &&
+         ban.hostname.matches(hostname);
+}
+
+/**
+ * @brief Files a mask under its most selective literal key: "n=" or "h="
+ * plus a whole nickname or hostname, "n<" plus the start of the nickname,
+ * "h>" plus the end of the hostname.
+ */
+void BanList::index_ban_(size_t i) {
+  const compiled_ban &ban = compiled_[i];
+  std::string key;
+  if (ban.nickname.is_literal()) {
+    key = "n=" + ban.nickname.literal_prefix();
+  } else if (ban.hostname.is_literal()) {
+    key = "h=" + ban.hostname.literal_prefix();
+  } else if (!ban.nickname.literal_prefix().empty()) {
+    key = "n<" + ban.nickname.literal_prefix().substr(0, BAN_INDEX_AFFIX_MAX);
+  } else if (!ban.hostname.literal_suffix().empty()) {
+    const std::string &suffix = ban.hostname.literal_suffix();
+    size_t length = std::min(suffix.size(), (size_t)BAN_INDEX_AFFIX_MAX);
+    key = "h>" + suffix.substr(suffix.size() - length);
+  } else {
+    unindexed_.push_back(i);
+    return;
+  }
+  index_[key].push_back(i);
+}
+
+void BanList::rebuild_index_() {
+  index_.clear();
+  unindexed_.clear();
+  for (size_t i = 0; i < compiled_.size(); ++i) index_ban_(i);
+}
+
+bool BanList::add(const std::string &nickname, const std::string &username,
+                  const std::string &hostname, const std::string &banned_by) {
+  // Banmask already exists?
+  for (size_t i = 0; i < masks_.size(); ++i) {
+    if (masks_[i].banned_nickname == nickname &&
+        masks_[i].banned_username == username &&
+        masks_[i].banned_hostname == hostname)
+      return false;
+  }
+
+  banmask new_banmask;
+  new_banmask.banned_nickname = nickname;
+  new_banmask.banned_username = username;
+  new_banmask.banned_hostname = hostname;
+  new_banmask.banned_by = banned_by;
+  new_banmask.time_of_ban = time(NULL);
+  masks_.push_back(new_banmask);
+  compiled_.push_back(compile_(new_banmask));
+  index_ban_(masks_.size() - 1);
+  if (++epoch_ == 0) ++epoch_;  // 0 marks a verdict never taken
+  return true;
+}
+
+std::pair<size_t, std::string> BanList::remove_matching(
+    const std::string &arg) {
+  size_t n_removed_masks = 0;
+  std::string removed_masks;
+
+  banmask pattern;
+  parse_banmask(arg, pattern.banned_nickname, pattern.banned_username,
+                pattern.banned_hostname);
+  compiled_ban removing = compile_(pattern);
+
+  size_t kept = 0;
+  for (size_t i = 0; i < masks_.size(); ++i) {
+    const banmask &current = masks_[i];
+    if (compiled_matches_(removing, irc_casefold(current.banned_nickname),
+                          irc_casefold(current.banned_username),
+                          irc_casefold(current.banned_hostname))) {
+      std::stringstream removed_mask;
+      removed_mask << current.banned_nickname << "!" << current.banned_username
+                   << "@" << current.banned_hostname;
+      if (!removed_masks.empty()) {
+        removed_masks += " ";
+      }
+      removed_masks += removed_mask.str();
+      ++n_removed_masks;
+    } else {
+      if (kept != i) {
+        masks_[kept] = masks_[i];
+        compiled_[kept] = compiled_[i];
+      }
+      ++kept;
+    }
+  }
+  if (n_removed_masks) {
+    masks_.resize(kept);
+    compiled_.resize(kept);
+    rebuild_index_();
+    if (++epoch_ == 0) ++epoch_;  // 0 marks a verdict never taken
+  }
+  return std::make_pair(n_removed_masks, removed_masks);
+}
+
+bool BanList::candidates_match_(const std::string &key,
+                                const std::string &nickname,
+                                const std::string &username,
+                                const std::string &hostname) const {
+  ban_index::const_iterator found = index_.find(key);
+  if (found == index_.end()) return false;
+  const std::vector<size_t> &candidates = found->second;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    if (compiled_matches_(compiled_[candidates[i]], nickname, username,
+                          hostname))
+      return true;
+  }
+  return false;
+}
+
+// banmask: <nickname>!<username>@hostname
+bool BanList::matches(const std::string &nickname, const std::string &username,
+                      const std::string &hostname) const {
+  if (masks_.empty()) return false;
+
+  std::string nick = irc_casefold(nickname);
+  std::string user = irc_casefold(username);
+  std::string host = irc_casefold(hostname);
+
+  if (candidates_match_("n=" + nick, nick, user, host) ||
+      candidates_match_("h=" + host, nick, user, host))
+    return true;
+  for (size_t length = 1;
+       length <= BAN_INDEX_AFFIX_MAX && length <= nick.size(); ++length) {
+    if (candidates_match_("n<" + nick.substr(0, length), nick, user, host))
+      return true;
+  }
+  for (size_t length = 1;
+       length <= BAN_INDEX_AFFIX_MAX && length <= host.size(); ++length) {
+    if (candidates_match_("h>" + host.substr(host.size() - length), nick,
+                          user, host))
+      return true;
+  }
+  for (size_t i = 0; i < unindexed_.size(); ++i) {
+    if (compiled_matches_(compiled_[unindexed_[i]], nick, user, host))
+      return true;
+  }
+  return false;
+}
+
+const std::vector<banmask> &BanList::masks() const { return masks_; }
+
+uint32_t BanList::epoch() const { return epoch_; }
+
+}  // namespace irc
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "WildcardMask.hpp"
+#include "include.hpp"
+
+// Longest literal prefix (nick) or suffix (host) a ban is indexed by
+#define BAN_INDEX_AFFIX_MAX 4
+
+namespace irc {
+
+struct banmask {
+  std::string banned_nickname;
+  std::string banned_username;
+  std::string banned_hostname;
+  std::string banned_by;
+  std::time_t time_of_ban;
+};
+
+/**
+ * @brief The +b masks of a channel, each compiled once into three
+ * WildcardMasks. For lookups every mask is filed under one literal key:
+ * its whole nickname or hostname if that has no wildcard, else the start of
+ * its nickname or the end of its hostname. A client is only tested against
+ * the masks filed under the keys its own nickmask produces, plus the few
+ * masks that have no literal part to file them under.
+ *
+ * The epoch changes with every added or removed mask, so verdicts cached
+ * against it go stale by themselves.
+ */
+class BanList {
+ public:
+  BanList();
+  BanList(const BanList &other);
+  BanList &operator=(const BanList &other);
+  ~BanList();
+
+  bool add(const std::string &nickname, const std::string &username,
+           const std::string &hostname, const std::string &banned_by);
+  // Removes every mask the argument matches, returns them
+  std::pair<size_t, std::string> remove_matching(const std::string &arg);
+  // Does one of the masks match? Also tells if a new mask (given as the
+  // strings) is already covered by the list.
+  bool matches(const std::string &nickname, const std::string &username,
+               const std::string &hostname) const;
+  const std::vector<banmask> &masks() const;
+  uint32_t epoch() const;
+
+ private:
+  struct compiled_ban {
+    WildcardMask nickname;
+    WildcardMask username;
+    WildcardMask hostname;
+  };
+
+  typedef std::map<std::string, std::vector<size_t> > ban_index;
+
+  static compiled_ban compile_(const banmask &mask);
+  static bool compiled_matches_(const compiled_ban &ban,
+                                const std::string &nickname,
+                                const std::string &username,
+                                const std::string &hostname);
+  bool candidates_match_(const std::string &key, const std::string &nickname,
+                         const std::string &username,
+                         const std::string &hostname) const;
+  void index_ban_(size_t i);
+  void rebuild_index_();
+
+  std::vector<banmask> masks_;
+  // compiled_[i] is masks_[i]
+  std::vector<compiled_ban> compiled_;
+  ban_index index_;
+  std::vector<size_t> unindexed_;
+  uint32_t epoch_;
+};
+
+}  // namespace irc
@@ -3,9 +3,7 @@
 namespace irc {
 
 Channel::Channel()
-    : users_(0),
-      operators_(),
-      speakers_(),
+    : members_(),
       invited_users_(),
       banned_users_(),
       channel_password_(),
@@ -17,10 +15,8 @@ Channel::Channel()
   channel_creationtime = time(NULL);
 }
 
-Channel::Channel(const std::string& creator, const std::string& name)
-    : users_(1, creator),
-      operators_(),
-      speakers_(),
+Channel::Channel(client_id creator, const std::string& name)
+    : members_(),
       invited_users_(),
       banned_users_(),
       channel_password_(),
@@ -28,15 +24,13 @@ Channel::Channel(const std::string& creator, const std::string& name)
       channel_name_(name),
       channel_user_limit_(),
       channel_flags_(0) {
-  operators_.insert(creator);
+  members_.insert(creator, MEMBER_OPERATOR);
   topicstatus_.topic_is_set = false;
   channel_creationtime = time(NULL);
 }
 
 Channel::Channel(const Channel& other)
-    : users_(other.users_),
-      operators_(other.operators_),
-      speakers_(other.speakers_),
+    : members_(other.members_),
       invited_users_(other.invited_users_),
       banned_users_(other.banned_users_),
       channel_password_(other.channel_password_),
@@ -53,10 +47,8 @@ Channel::Channel(const Channel& other)
 
 Channel& Channel::operator=(const Channel& other) {
   if (this != &other) {
-    users_ = other.users_;
-    operators_ = other.operators_;
+    members_ = other.members_;
     banned_users_ = other.banned_users_;
-    speakers_ = other.speakers_;
     invited_users_ = other.invited_users_;
     channel_password_ = other.channel_password_;
     channel_topic_ = other.channel_topic_;
@@ -88,26 +80,17 @@ bool Channel::checkflag(uint8_t flagname) const {
   return channel_flags_ >> flagname & 1;
 }
 
-const std::vector<std::string>& Channel::get_users(void) const {
-  return users_;
+const std::vector<member>& Channel::get_members(void) const {
+  return members_.members();
 }
 
-const std::set<std::string, irc_stringmapcomparator<std::string> >&
-Channel::get_operators(void) const {
-  return operators_;
-}
+size_t Channel::get_member_count(void) const { return members_.size(); }
 
 const std::vector<banmask>& Channel::get_banned_users(void) const {
-  return banned_users_;
-}
-
-const std::set<std::string, irc_stringmapcomparator<std::string> >&
-Channel::get_speakers(void) const {
-  return speakers_;
+  return banned_users_.masks();
 }
 
-const std::set<std::string, irc_stringmapcomparator<std::string> >&
-Channel::get_invited_users(void) const {
+const std::set<client_id>& Channel::get_invited_users(void) const {
   return invited_users_;
 }
 
@@ -131,137 +114,93 @@ const size_t& Channel::get_user_limit(void) const {
 
 void Channel::set_user_limit(size_t limit) { channel_user_limit_ = limit; }
 
-bool Channel::is_user(const std::string& user_name) const {
-  for (size_t i = 0; i < users_.size(); ++i) {
-    if (irc_stringissame(user_name, users_[i])) return true;
-  }
-  return false;
+bool Channel::is_user(client_id id) const {
+  return members_.find(id) != NULL;
 }
 
-bool Channel::is_operator(const std::string& user_name) const {
-  if (operators_.find(user_name) != operators_.end()) return true;
-  return false;
+bool Channel::is_operator(client_id id) const {
+  const member* record = members_.find(id);
+  return record && (record->flags & MEMBER_OPERATOR);
+}
+
+bool Channel::is_banned(const Client& client) {
+  member* record = members_.find(client.get_id());
+  if (record && record->ban_epoch == banned_users_.epoch())
+    return record->banned;
+
+  bool banned = banned_users_.matches(
+      client.get_nickname(), client.get_username(), client.get_hostname());
+  if (record) {
+    record->ban_epoch = banned_users_.epoch();
+    record->banned = banned;
+  }
+  return banned;
 }
 
 // banmask: <nickname>!<username>@hostname
 bool Channel::is_banned(const std::string& nickname,
                         const std::string& username,
                         const std::string& hostname) const {
-  for (size_t i = 0; i < banned_users_.size(); ++i) {
-    const banmask& tmp = banned_users_[i];
-    if (irc_wildcard_cmp(nickname.c_str(), tmp.banned_nickname.c_str()) &&
-        irc_wildcard_cmp(username.c_str(), tmp.banned_username.c_str()) &&
-        irc_wildcard_cmp(hostname.c_str(), tmp.banned_hostname.c_str()))
-      return true;
-  }
-  return false;
+  return banned_users_.matches(nickname, username, hostname);
 }
 
-bool Channel::is_speaker(const std::string& user_name) const {
-  if (speakers_.find(user_name) != speakers_.end()) return true;
-  return false;
+bool Channel::is_speaker(client_id id) const {
+  const member* record = members_.find(id);
+  return record && (record->flags & MEMBER_SPEAKER);
 }
 
-bool Channel::is_invited(const std::string& user_name) const {
-  return invited_users_.find(user_name) != invited_users_.end();
+bool Channel::is_invited(client_id id) const {
+  return invited_users_.find(id) != invited_users_.end();
 }
 
-void Channel::add_user(const std::string& user_name) {
-  users_.push_back(user_name);
-}
+void Channel::add_user(client_id id) { members_.insert(id, 0); }
 
-void Channel::add_operator(const std::string& user_name) {
-  operators_.insert(user_name);
+void Channel::add_operator(client_id id) {
+  member* record = members_.find(id);
+  if (record) record->flags |= MEMBER_OPERATOR;
 }
 
 bool Channel::add_banmask(const std::string& nickname,
                           const std::string& username,
                           const std::string& hostname,
                           const std::string& banned_by) {
-  // Banmask already exists?
-  for (size_t i = 0; i < banned_users_.size(); ++i) {
-    if (banned_users_[i].banned_nickname == nickname &&
-        banned_users_[i].banned_username == username &&
-        banned_users_[i].banned_hostname == hostname)
-      return false;
-  }
-
-  banmask new_banmask;
-  new_banmask.banned_nickname = nickname;
-  new_banmask.banned_username = username;
-  new_banmask.banned_hostname = hostname;
-  new_banmask.banned_by = banned_by;
-  new_banmask.time_of_ban = time(NULL);
-  banned_users_.push_back(new_banmask);
-  return true;
+  return banned_users_.add(nickname, username, hostname, banned_by);
 }
 
-void Channel::add_speaker(const std::string& user_name) {
-  speakers_.insert(user_name);
+void Channel::add_speaker(client_id id) {
+  member* record = members_.find(id);
+  if (record) record->flags |= MEMBER_SPEAKER;
 }
 
-void Channel::add_invited_user(const std::string& user_name) {
-  invited_users_.insert(user_name);
+void Channel::add_invited_user(client_id id) {
+  invited_users_.insert(id);
 }
 
-void Channel::remove_user(const std::string& user_name) {
-  if (is_operator(user_name)) remove_operator(user_name);
-  if (is_invited(user_name)) remove_invited_user(user_name);
-  if (is_speaker(user_name)) remove_speaker(user_name);
-  for (std::vector<std::string>::iterator it = users_.begin();
-       it != users_.end(); ++it) {
-    if (irc_stringissame(user_name, *it)) {
-      users_.erase(it);
-      return;
-    }
-  }
-}
+// The flags go with the member record
+void Channel::remove_user(client_id id) { members_.erase(id); }
 
-void Channel::remove_operator(const std::string& user_name) {
-  operators_.erase(user_name);
+void Channel::remove_operator(client_id id) {
+  member* record = members_.find(id);
+  if (record) record->flags &= ~MEMBER_OPERATOR;
 }
 
 std::pair<size_t, std::string> Channel::remove_banmask(const std::string& arg) {
-  size_t n_removed_masks = 0;
-  std::string removed_masks;
-
-  std::string banmask_nickname;
-  std::string banmask_username;
-  std::string banmask_hostname;
-  parse_banmask(arg, banmask_nickname, banmask_username, banmask_hostname);
-
-  std::vector<banmask>::iterator it = banned_users_.begin();
-  std::vector<banmask>::iterator end = banned_users_.end();
-  while (it != end) {
-    banmask& current = *it;
-    if (irc_wildcard_cmp(current.banned_nickname.c_str(),
-                         banmask_nickname.c_str()) &&
-        irc_wildcard_cmp(current.banned_username.c_str(),
-                         banmask_username.c_str()) &&
-        irc_wildcard_cmp(current.banned_hostname.c_str(),
-                         banmask_hostname.c_str())) {
-      std::stringstream removed_mask;
-      removed_mask << current.banned_nickname << "!" << current.banned_username
-                   << "@" << current.banned_hostname;
-      if (!removed_masks.empty()) {
-        removed_masks += " ";
-      }
-      removed_masks += removed_mask.str();
-      ++n_removed_masks;
-      banned_users_.erase(it++);
-    } else {
-      ++it;
-    }
-  }
-  return std::make_pair(n_removed_masks, removed_masks);
+  return banned_users_.remove_matching(arg);
+}
+
+void Channel::remove_speaker(client_id id) {
+  member* record = members_.find(id);
+  if (record) record->flags &= ~MEMBER_SPEAKER;
 }
 
-void Channel::remove_speaker(const std::string& user_name) {
-  speakers_.erase(user_name);
+void Channel::remove_invited_user(client_id id) {
+  invited_users_.erase(id);
 }
 
-void Channel::remove_invited_user(const std::string& user_name) {
-  invited_users_.erase(user_name);
+// The member's nickname or hostname changed
+void Channel::forget_ban_status(client_id id) {
+  member* record = members_.find(id);
+  if (record) record->ban_epoch = 0;
 }
 
 bool Channel::is_topic_set() const { return topicstatus_.topic_is_set; }
@@ -296,19 +235,4 @@ const std::string& Channel::get_channelname() const { return channel_name_; }
 
 std::time_t Channel::get_creationtime() { return channel_creationtime; }
 
-void Channel::change_nickname(const std::string& old_nickname, const std::string& new_nickname) {
-  // Change in userlist
-  for (size_t i = 0; i < users_.size(); ++i) {
-    if (irc_stringissame(users_[i], old_nickname))
-      users_[i] = new_nickname;
-  }
-
-  // Change in other lists
-  if (operators_.erase(old_nickname))
-    operators_.insert(new_nickname);
-  if (speakers_.erase(old_nickname))
-    speakers_.insert(new_nickname);
-  // Invited_users should never contain a member of the channel
-}
-
 }  // namespace irc
\ No newline at end of file
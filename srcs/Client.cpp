@@ -15,7 +15,23 @@ bool server_notices_;
 uint8_t auth_status_;
 
 Client::Client()
-    : server_operator_status_(0), server_notices_(0), auth_status_(0) {}
+    // Value-initialized: not pinged, no ping time
+    : pingstatus_(),
+      server_operator_status_(0),
+      server_notices_(0),
+      auth_status_(0),
+      send_queue_(),
+      flush_scheduled_(false),
+      reactor_(0),
+      id_(0),
+      timer_(0),
+      last_active_(0),
+      flood_clock_(0),
+      deferred_(false),
+      runnable_(false),
+      sendq_exceeded_(false),
+      nickmask_("!@"),
+      reply_prefix_() {}
 Client::~Client() {}
 
 Client::Client(const Client &other) {
@@ -30,6 +46,18 @@ Client::Client(const Client &other) {
   server_operator_status_ = other.server_operator_status_;
   server_notices_ = other.server_notices_;
   auth_status_ = other.auth_status_;
+  send_queue_ = other.send_queue_;
+  flush_scheduled_ = other.flush_scheduled_;
+  reactor_ = other.reactor_;
+  id_ = other.id_;
+  timer_ = other.timer_;
+  last_active_ = other.last_active_;
+  flood_clock_ = other.flood_clock_;
+  deferred_ = other.deferred_;
+  runnable_ = other.runnable_;
+  sendq_exceeded_ = other.sendq_exceeded_;
+  nickmask_ = other.nickmask_;
+  reply_prefix_ = other.reply_prefix_;
 }
 
 Client &Client::operator=(const Client &other) {
@@ -45,16 +73,37 @@ Client &Client::operator=(const Client &other) {
     server_operator_status_ = other.server_operator_status_;
     server_notices_ = other.server_notices_;
     auth_status_ = other.auth_status_;
+      send_queue_ = other.send_queue_;
+    flush_scheduled_ = other.flush_scheduled_;
+    reactor_ = other.reactor_;
+    id_ = other.id_;
+    timer_ = other.timer_;
+    last_active_ = other.last_active_;
+    flood_clock_ = other.flood_clock_;
+    deferred_ = other.deferred_;
+    runnable_ = other.runnable_;
+    sendq_exceeded_ = other.sendq_exceeded_;
+    nickmask_ = other.nickmask_;
+    reply_prefix_ = other.reply_prefix_;
   }
   return *this;
 }
 
 // setters
-void Client::set_nickname(std::string nickname) { nickname_ = nickname; }
+void Client::set_nickname(std::string nickname) {
+  nickname_ = nickname;
+  update_nickmask_();
+}
 
-void Client::set_username(std::string username) { username_ = username; }
+void Client::set_username(std::string username) {
+  username_ = username;
+  update_nickmask_();
+}
 
-void Client::set_hostname(std::string hostname) { hostname_ = hostname; }
+void Client::set_hostname(std::string hostname) {
+  hostname_ = hostname;
+  update_nickmask_();
+}
 
 void Client::set_ip_addr(std::string ip_addr) { ip_addr_ = ip_addr; }
 
@@ -69,6 +118,26 @@ void Client::set_new_ping() {
   pingstatus_.expected_response = oss.str();
 }
 
+void Client::set_flush_scheduled(bool scheduled) {
+  flush_scheduled_ = scheduled;
+}
+
+void Client::set_reactor(size_t index) { reactor_ = index; }
+
+void Client::set_id(client_id id) { id_ = id; }
+
+void Client::set_timer(uint32_t timer) { timer_ = timer; }
+
+void Client::set_last_active(uint64_t tick) { last_active_ = tick; }
+
+void Client::set_flood_clock(uint64_t clock_ms) { flood_clock_ = clock_ms; }
+
+void Client::set_deferred(bool deferred) { deferred_ = deferred; }
+
+void Client::set_runnable(bool runnable) { runnable_ = runnable; }
+
+void Client::set_sendq_exceeded() { sendq_exceeded_ = true; }
+
 void Client::add_channel(std::string channel) { 
   if (std::find(channels_.begin(), channels_.end(), channel) == channels_.end())
     channels_.push_back(channel);
@@ -112,11 +181,23 @@ const std::string &Client::get_hostname() const { return hostname_; }
 
 const std::string &Client::get_ip_addr() const { return ip_addr_; }
 
-const std::string Client::get_nickmask() const {
-  std::stringstream nickmask;
-  nickmask << get_nickname() << "!" << get_username() << "@" << get_hostname();
-  std::string tmp(nickmask.str());
-  return tmp;
+const std::string &Client::get_nickmask() const { return nickmask_; }
+
+const std::string &Client::get_reply_prefix() const { return reply_prefix_; }
+
+void Client::update_nickmask_() {
+  nickmask_.clear();
+  nickmask_.append(nickname_).append("!").append(username_);
+  nickmask_.append("@").append(hostname_);
+}
+
+/**
+ * @brief Has to be called again after the nickname changed.
+ */
+void Client::set_reply_prefix(const std::string &server_name) {
+  reply_prefix_.clear();
+  reply_prefix_.append(":").append(server_name).append(" 000 ");
+  reply_prefix_.append(nickname_);
 }
 
 bool Client::is_authorized() const { return (auth_status_ == 15); }
@@ -147,6 +228,26 @@ const std::string &Client::get_expected_ping_response() const {
   return pingstatus_.expected_response;
 }
 
+SendQueue &Client::get_send_queue() { return send_queue_; }
+
+bool Client::get_flush_scheduled() const { return flush_scheduled_; }
+
+size_t Client::get_reactor() const { return reactor_; }
+
+client_id Client::get_id() const { return id_; }
+
+uint32_t Client::get_timer() const { return timer_; }
+
+uint64_t Client::get_last_active() const { return last_active_; }
+
+uint64_t Client::get_flood_clock() const { return flood_clock_; }
+
+bool Client::is_deferred() const { return deferred_; }
+
+bool Client::is_runnable() const { return runnable_; }
+
+bool Client::is_sendq_exceeded() const { return sendq_exceeded_; }
+
 void Client::remove_channel_from_channellist(const std::string &channelname) {
   std::vector<std::string>::iterator it =
       std::find(channels_.begin(), channels_.end(), channelname);
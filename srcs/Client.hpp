@@ -1,5 +1,6 @@
 #pragma once
 
+#include "SendQueue.hpp"
 #include "include.hpp"
 #define PASS_AUTH 0x01 //0b00000001 if (authentication_ & PASS_AUTH) means this bit is a 1
 #define USER_AUTH 0x02 //0b00000010 if (authentication_ & USER_AUTH)
@@ -8,6 +9,9 @@
 
 namespace irc {
 
+// Assigned when a connection is accepted, never reused while the server runs
+typedef uint64_t client_id;
+
 struct pingstatus {
   bool pingstatus;
   std::time_t time_of_ping;
@@ -35,13 +39,25 @@ public:
   void set_server_notices_status(bool status);
   void set_pingstatus(bool ping);
   void set_new_ping();
+  void set_flush_scheduled(bool scheduled);
+  void set_reactor(size_t index);
+  void set_id(client_id id);
+  void set_reply_prefix(const std::string &server_name);
+  void set_timer(uint32_t timer);
+  void set_last_active(uint64_t tick);
+  void set_flood_clock(uint64_t clock_ms);
+  void set_deferred(bool deferred);
+  void set_runnable(bool runnable);
+  void set_sendq_exceeded();
 
   // getters
   const std::string &get_nickname() const;
   const std::string &get_username() const;
   const std::string &get_hostname() const;
   const std::string &get_ip_addr() const;
-  const std::string get_nickmask() const;
+  const std::string &get_nickmask() const;
+  // ":<server> 000 <nick>", the digits are the numeric's
+  const std::string &get_reply_prefix() const;
   bool is_authorized() const;
   bool get_status(uint8_t flag) const;
   const std::vector<std::string> &get_channels_list() const;
@@ -51,6 +67,16 @@ public:
   bool get_ping_status() const;
   const std::time_t &get_ping_time() const;
   const std::string &get_expected_ping_response() const;
+  SendQueue &get_send_queue();
+  bool get_flush_scheduled() const;
+  size_t get_reactor() const;
+  client_id get_id() const;
+  uint32_t get_timer() const;
+  uint64_t get_last_active() const;
+  uint64_t get_flood_clock() const;
+  bool is_deferred() const;
+  bool is_runnable() const;
+  bool is_sendq_exceeded() const;
 
   // functions
   void remove_channel_from_channellist(const std::string &channelname);
@@ -67,6 +93,28 @@ private:
   bool server_operator_status_;
   bool server_notices_;
   uint8_t auth_status_;
+  SendQueue send_queue_;
+  bool flush_scheduled_;
+  size_t reactor_;
+  client_id id_;
+  // Handle in the owning reactor's TimerWheel, 0 if none is armed
+  uint32_t timer_;
+  // Clock tick (second) of the last input
+  uint64_t last_active_;
+  // Token bucket as a virtual clock (ms): every command pushes it forward by
+  // its cost, the bucket is empty once it runs ahead by the burst window
+  uint64_t flood_clock_;
+  // Listed in the reactor's deferred clients
+  bool deferred_;
+  // Listed in the reactor's runnable clients
+  bool runnable_;
+  // Over the hard SendQ limit, dropped at the end of the loop iteration
+  bool sendq_exceeded_;
+  // Rebuilt when the parts change, a reply only copies them
+  std::string nickmask_;
+  std::string reply_prefix_;
+
+  void update_nickmask_();
 };
 
 } // namespace irc
\ No newline at end of file
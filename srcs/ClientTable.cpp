@@ -0,0 +1,85 @@
+#include "ClientTable.hpp"
+
+namespace irc {
+
+ClientTable::ClientTable() : pages_(), fds_() {}
+
+ClientTable::~ClientTable() {
+  for (size_t i = 0; i < pages_.size(); ++i) delete[] pages_[i];
+}
+
+ClientTable::client_slot *ClientTable::slot_(int fd) const {
+  if (fd < 0) return NULL;
+  size_t page = fd / CLIENT_TABLE_PAGE;
+  if (page >= pages_.size() || !pages_[page]) return NULL;
+  return &pages_[page][fd % CLIENT_TABLE_PAGE];
+}
+
+Client *ClientTable::find(int fd) {
+  client_slot *slot = slot_(fd);
+  return slot && slot->live ? &slot->client : NULL;
+}
+
+const Client *ClientTable::find(int fd) const {
+  const client_slot *slot = slot_(fd);
+  return slot && slot->live ? &slot->client : NULL;
+}
+
+Client &ClientTable::operator[](int fd) { return slot_(fd)->client; }
+
+/**
+ * @brief Stores a new connection. The slot gets a new generation and the
+ * client a new id, so ids of the previous connection on this fd are
+ * recognized as stale.
+ *
+ * @param fd the connection's file descriptor, must not be live
+ * @param client the initial state
+ * @return the stored client
+ */
+Client &ClientTable::insert(int fd, const Client &client) {
+  size_t page = fd / CLIENT_TABLE_PAGE;
+  if (page >= pages_.size()) pages_.resize(page + 1, NULL);
+  if (!pages_[page]) pages_[page] = new client_slot[CLIENT_TABLE_PAGE];
+
+  client_slot &slot = pages_[page][fd % CLIENT_TABLE_PAGE];
+  slot.client = client;
+  // Never 0, so 0 is not a valid id
+  if (!++slot.generation) ++slot.generation;
+  slot.client.set_id((client_id)slot.generation << 32 | (uint32_t)fd);
+  slot.live = true;
+  slot.position = fds_.size();
+  fds_.push_back(fd);
+  return slot.client;
+}
+
+void ClientTable::erase(int fd) {
+  client_slot *slot = slot_(fd);
+  if (!slot || !slot->live) return;
+
+  // Swap the last live fd into the hole
+  int moved = fds_.back();
+  fds_[slot->position] = moved;
+  slot_(moved)->position = slot->position;
+  fds_.pop_back();
+
+  slot->live = false;
+  // Releases the buffers
+  slot->client = Client();
+}
+
+void ClientTable::clear() {
+  while (!fds_.empty()) erase(fds_.back());
+}
+
+bool ClientTable::is_live(client_id id) const {
+  const client_slot *slot = slot_(fd_of(id));
+  return slot && slot->live && slot->client.get_id() == id;
+}
+
+int ClientTable::fd_of(client_id id) { return (int)(uint32_t)id; }
+
+size_t ClientTable::size() const { return fds_.size(); }
+
+const std::vector<int> &ClientTable::fds() const { return fds_; }
+
+}  // namespace irc
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Client.hpp"
+#include "include.hpp"
+
+// Slots per page, pages are allocated when the first fd in them is used
+#define CLIENT_TABLE_PAGE 256
+
+namespace irc {
+
+/**
+ * @brief All connections, indexed by fd. A lookup is two array indexes, a
+ * slot's address never changes (so references stay valid while others
+ * connect) and every reuse of an fd bumps the slot's generation. The live
+ * fds are kept in a dense list for iteration.
+ *
+ * A client's id is its slot's generation and its fd in one number: the fd
+ * is recovered without a lookup, and an id of a closed connection never
+ * matches the slot again.
+ */
+class ClientTable {
+ public:
+  ClientTable();
+  ~ClientTable();
+
+  Client *find(int fd);
+  const Client *find(int fd) const;
+  // The fd must be live
+  Client &operator[](int fd);
+  Client &insert(int fd, const Client &client);
+  void erase(int fd);
+  void clear();
+
+  bool is_live(client_id id) const;
+  static int fd_of(client_id id);
+  size_t size() const;
+  const std::vector<int> &fds() const;
+
+ private:
+  struct client_slot {
+    client_slot() : client(), generation(0), live(false), position(0) {}
+
+    Client client;
+    unsigned generation;
+    bool live;
+    // Index in fds_
+    size_t position;
+  };
+
+  client_slot *slot_(int fd) const;
+
+  std::vector<client_slot *> pages_;
+  std::vector<int> fds_;
+
+  // Not used
+  ClientTable(const ClientTable &other);
+  ClientTable &operator=(const ClientTable &other);
+};
+
+}  // namespace irc
@@ -0,0 +1,168 @@
+#include "EpollBackend.hpp"
+
+namespace irc {
+
+EpollBackend::EpollBackend(size_t batch)
+    : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+      listen_fd_(-1),
+      wake_fd_(-1),
+      shutdown_fd_(-1),
+      ready_(batch),
+      interest_(),
+      submitting_(),
+      completed_() {
+  if (epoll_fd_ < 0)
+    throw std::runtime_error("Failed to create epoll instance");
+}
+
+EpollBackend::~EpollBackend() { close(epoll_fd_); }
+
+const char *EpollBackend::name() const { return "epoll"; }
+
+void EpollBackend::watch(int listen_fd, int wake_fd, int shutdown_fd) {
+  listen_fd_ = listen_fd;
+  wake_fd_ = wake_fd;
+  shutdown_fd_ = shutdown_fd;
+  int watched[3] = {listen_fd, wake_fd, shutdown_fd};
+  for (size_t i = 0; i < 3; ++i) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = watched[i];
+
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, watched[i], &event) < 0)
+      throw std::runtime_error(
+          "Failed to add socket file descriptor to epoll list");
+  }
+}
+
+int EpollBackend::add(int fd) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = fd;
+
+  if ((size_t)fd >= interest_.size()) interest_.resize(fd + 1, 0);
+  interest_[fd] = EPOLLIN;
+  return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0 ? -1 : 0;
+}
+
+void EpollBackend::remove(int fd) {
+  forget_send_(fd);
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, NULL);
+}
+
+/**
+ * @brief EPOLLOUT is edge-triggered: it is armed once the socket didn't take
+ * everything, and reports when it drained.
+ */
+int EpollBackend::send_done(const io_event &event, SendQueue *queue) {
+  const io_send *done =
+      reinterpret_cast<const io_send *>((uintptr_t)event.token);
+  int fd = done->fd;
+  bool current = is_sending_(done);
+  bool full = done->result == -EAGAIN ||
+              (done->result >= 0 && (size_t)done->result < done->size);
+
+  int status = EventBackend::send_done(event, queue);
+  if (!current || status < 0) return status;
+  set_pollout_(fd, full && queue && !queue->empty());
+  return full ? 1 : 0;
+}
+
+void EpollBackend::rearm() { take_sends_(submitting_); }
+
+void EpollBackend::submit() {
+  for (size_t i = 0; i < submitting_.size(); ++i) {
+    io_send *pending = submitting_[i];
+    ssize_t sent;
+    do {
+      sent = sendmsg(pending->fd, &pending->header,
+                     MSG_NOSIGNAL | MSG_DONTWAIT);
+    } while (sent < 0 && errno == EINTR);
+    pending->result = sent < 0 ? -errno : sent;
+    completed_.push_back(pending);
+  }
+  submitting_.clear();
+}
+
+/**
+ * @brief Without EPOLLIN the data stays in the socket buffer. Modifying the
+ * interest checks the readiness again, so data that came in meanwhile is
+ * reported once reading resumes, edge-triggered or not.
+ */
+void EpollBackend::set_reading(int fd, bool reading) {
+  if ((size_t)fd >= interest_.size()) return;
+  modify_(fd, reading ? interest_[fd] | EPOLLIN : interest_[fd] & ~EPOLLIN);
+}
+
+// The listener is level-triggered: while it is off, the backlog just waits
+void EpollBackend::set_accepting(bool accepting) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = accepting ? (uint32_t)EPOLLIN : 0;
+  event.data.fd = listen_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, listen_fd_, &event);
+}
+
+void EpollBackend::set_pollout_(int fd, bool armed) {
+  if ((size_t)fd >= interest_.size()) return;
+  modify_(fd, armed ? interest_[fd] | EPOLLOUT : interest_[fd] & ~EPOLLOUT);
+}
+
+void EpollBackend::modify_(int fd, uint32_t interest) {
+  if (interest_[fd] == interest) return;
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = interest | EPOLLET;
+  event.data.fd = fd;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) == 0)
+    interest_[fd] = interest;
+}
+
+// The results of submit() come first, they don't wait for anything else
+int EpollBackend::wait(std::vector<io_event> &events, int timeout_ms) {
+  io_event event;
+  memset(&event, 0, sizeof(event));
+  event.type = IO_SENT;
+  for (size_t i = 0; i < completed_.size(); ++i) {
+    event.fd = completed_[i]->fd;
+    event.token = (uintptr_t)completed_[i];
+    event.size = completed_[i]->size;
+    event.result = completed_[i]->result;
+    events.push_back(event);
+  }
+  int n_sent = completed_.size();
+  completed_.clear();
+
+  int n_ready = epoll_wait(epoll_fd_, &ready_[0], ready_.size(),
+                           n_sent ? 0 : timeout_ms);
+  if (n_ready < 0) return n_sent ? n_sent : -1;
+
+  memset(&event, 0, sizeof(event));
+  for (int i = 0; i < n_ready; ++i) {
+    event.fd = ready_[i].data.fd;
+    if (event.fd == listen_fd_) {
+      event.type = IO_ACCEPT_READY;
+      events.push_back(event);
+      continue;
+    }
+    if (event.fd == wake_fd_ || event.fd == shutdown_fd_) {
+      event.type = IO_WAKE;
+      events.push_back(event);
+      continue;
+    }
+    if (ready_[i].events & EPOLLOUT) {
+      event.type = IO_WRITABLE;
+      events.push_back(event);
+    }
+    if (ready_[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+      event.type = IO_READABLE;
+      events.push_back(event);
+    }
+  }
+  return n_sent + n_ready;
+}
+
+}  // namespace irc
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "EventBackend.hpp"
+#include "include.hpp"
+
+namespace irc {
+
+/**
+ * @brief Readiness based I/O: client sockets are edge-triggered and the event
+ * loop reads them itself. The owner makes the sendmsg() calls in submit(),
+ * their results come back as IO_SENT from the next wait(). EPOLLOUT is only
+ * armed while a queue has bytes the socket didn't take.
+ */
+class EpollBackend : public EventBackend {
+ public:
+  explicit EpollBackend(size_t batch);
+  ~EpollBackend();
+
+  const char *name() const;
+  void watch(int listen_fd, int wake_fd, int shutdown_fd);
+  int add(int fd);
+  void remove(int fd);
+  void set_reading(int fd, bool reading);
+  void set_accepting(bool accepting);
+  int send_done(const io_event &event, SendQueue *queue);
+  void rearm();
+  void submit();
+  int wait(std::vector<io_event> &events, int timeout_ms);
+
+ private:
+  void set_pollout_(int fd, bool armed);
+  void modify_(int fd, uint32_t interest);
+
+  int epoll_fd_;
+  int listen_fd_;
+  int wake_fd_;
+  int shutdown_fd_;
+  std::vector<struct epoll_event> ready_;
+  // Indexed by fd: EPOLLIN unless reading is stopped, EPOLLOUT while armed
+  std::vector<uint32_t> interest_;
+  // Taken by rearm(), then sent by submit() and reported by wait()
+  std::vector<io_send *> submitting_;
+  std::vector<io_send *> completed_;
+};
+
+}  // namespace irc
@@ -0,0 +1,124 @@
+#include "EventBackend.hpp"
+
+#include "EpollBackend.hpp"
+#include "UringBackend.hpp"
+
+namespace irc {
+
+EventBackend::EventBackend()
+    : sending_(),
+      recorded_(),
+      free_sends_(NULL),
+      sends_(),
+      wake_needed_(false) {}
+
+EventBackend::~EventBackend() {
+  for (size_t i = 0; i < sends_.size(); ++i) delete sends_[i];
+}
+
+EventBackend *EventBackend::create(const ServerConfig &config) {
+  if (config.event_backend == BACKEND_URING) return new UringBackend();
+  return new EpollBackend(config.epoll_batch);
+}
+
+// A readiness backend acts at once, there are no late events
+bool EventBackend::is_current(int fd, uint32_t tag) const {
+  (void)fd;
+  (void)tag;
+  return true;
+}
+
+void EventBackend::send(int fd, SendQueue &queue) {
+  if (queue.empty()) return;
+  if ((size_t)fd >= sending_.size()) sending_.resize(fd + 1, NULL);
+  if (sending_[fd]) return;
+
+  io_send *pending = free_sends_;
+  if (pending)
+    free_sends_ = pending->next_free;
+  else {
+    pending = new io_send();
+    sends_.push_back(pending);
+  }
+  pending->fd = fd;
+  pending->tag = 0;
+  pending->queue_epoch = queue.epoch();
+  pending->count = queue.gather(pending->iov, pending->hold, SEND_IOV_MAX);
+  pending->size = 0;
+  for (size_t i = 0; i < pending->count; ++i)
+    pending->size += pending->iov[i].iov_len;
+  pending->result = 0;
+  memset(&pending->header, 0, sizeof(pending->header));
+  pending->header.msg_iov = pending->iov;
+  pending->header.msg_iovlen = pending->count;
+  pending->next_free = NULL;
+  sending_[fd] = pending;
+  recorded_.push_back(pending);
+  wake_needed_ = true;
+}
+
+// A recorded send has the front of the queue, the rest can't go before it
+void EventBackend::send_final(int fd, SendQueue &queue) {
+  if ((size_t)fd >= sending_.size() || !sending_[fd]) queue.flush(fd);
+}
+
+/**
+ * @brief Gives the chunks back before the queue drops them, so the blocks
+ * that went out are unique again and return to the pool. A send whose
+ * connection went away or whose queue was cleared meanwhile changes nothing.
+ */
+int EventBackend::send_done(const io_event &event, SendQueue *queue) {
+  io_send *done = reinterpret_cast<io_send *>((uintptr_t)event.token);
+  bool current = is_sending_(done);
+  if (current) sending_[done->fd] = NULL;
+  for (size_t i = 0; i < done->count; ++i) done->hold[i] = SharedBuffer();
+
+  int status = 0;
+  if (current && queue && queue->epoch() == done->queue_epoch) {
+    if (done->result > 0)
+      queue->consume(done->result);
+    else if (done->result < 0 && done->result != -EAGAIN &&
+             done->result != -EINTR)
+      status = -1;
+  }
+  release_send_(done);
+  return status;
+}
+
+void EventBackend::rearm() {}
+
+void EventBackend::submit() {}
+
+bool EventBackend::needs_wake() {
+  bool needed = wake_needed_;
+  wake_needed_ = false;
+  return needed;
+}
+
+void EventBackend::take_sends_(std::vector<io_send *> &taken) {
+  for (size_t i = 0; i < recorded_.size(); ++i) {
+    if (is_sending_(recorded_[i]))
+      taken.push_back(recorded_[i]);
+    else
+      release_send_(recorded_[i]);
+  }
+  recorded_.clear();
+  wake_needed_ = false;
+}
+
+void EventBackend::forget_send_(int fd) {
+  if ((size_t)fd < sending_.size()) sending_[fd] = NULL;
+}
+
+bool EventBackend::is_sending_(const io_send *pending) const {
+  return (size_t)pending->fd < sending_.size() &&
+         sending_[pending->fd] == pending;
+}
+
+void EventBackend::release_send_(io_send *done) {
+  for (size_t i = 0; i < done->count; ++i) done->hold[i] = SharedBuffer();
+  done->next_free = free_sends_;
+  free_sends_ = done;
+}
+
+}  // namespace irc
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "SendQueue.hpp"
+#include "ServerConfig.hpp"
+#include "include.hpp"
+
+namespace irc {
+
+/**
+ * @brief What a backend reports. A readiness backend (epoll) says what can be
+ * done now, a completion backend (io_uring) says what was done already; each
+ * only produces its own kinds.
+ */
+enum io_event_type {
+  // The listener has a connection waiting, accept() it (epoll)
+  IO_ACCEPT_READY,
+  // fd is a new connection (io_uring)
+  IO_ACCEPTED,
+  // Accepting failed with -result (io_uring)
+  IO_ACCEPT_FAILED,
+  // fd has data, read() it (epoll)
+  IO_READABLE,
+  // data/size arrived on fd (io_uring)
+  IO_DATA,
+  // The peer closed fd or it failed (io_uring)
+  IO_EOF,
+  // fd takes output again, flush it (epoll)
+  IO_WRITABLE,
+  // A send on fd completed, hand it to send_done()
+  IO_SENT,
+  // The wake or shutdown eventfd (fd) fired
+  IO_WAKE
+};
+
+struct io_event {
+  io_event_type type;
+  int fd;
+  // IO_DATA: valid until the next wait()
+  const char *data;
+  size_t size;
+  // Which connection on fd it belongs to, see EventBackend::is_current()
+  uint32_t tag;
+  // IO_SENT: the io_send that completed
+  uint64_t token;
+  // IO_SENT: bytes sent or -errno; IO_ACCEPT_FAILED: -errno
+  long result;
+};
+
+/**
+ * @brief A sendmsg() over the front of a send queue. The iovecs point into
+ * the queue's chunks and hold keeps those alive and unchanged (a shared block
+ * is never appended to), so the bytes may go out without the server lock.
+ */
+struct io_send {
+  int fd;
+  uint32_t tag;
+  uint32_t queue_epoch;
+  size_t count;
+  // Bytes in the iovecs, and how many went out (or -errno)
+  size_t size;
+  long result;
+  struct msghdr header;
+  struct iovec iov[SEND_IOV_MAX];
+  SharedBuffer hold[SEND_IOV_MAX];
+  io_send *next_free;
+};
+
+/**
+ * @brief The socket I/O of one reactor: accepting, receiving and sending on
+ * the connections it owns. The event loop only sees io_events.
+ *
+ * wait() and submit() run in the reactor's thread without the server lock;
+ * everything else runs with the lock held, possibly from another reactor's
+ * thread. A send() only records the io_send; the owner takes the records in
+ * rearm() and puts them on the wire outside the lock.
+ */
+class EventBackend {
+ public:
+  // The backend of the configured kind; throws if it is not available
+  static EventBackend *create(const ServerConfig &config);
+  virtual ~EventBackend();
+
+  virtual const char *name() const = 0;
+  virtual void watch(int listen_fd, int wake_fd, int shutdown_fd) = 0;
+  // -1 if the connection can't be watched
+  virtual int add(int fd) = 0;
+  // Before the fd is closed, which is left to the owner after its rearm();
+  // the connection gets no further events
+  virtual void remove(int fd) = 0;
+  // Stops or resumes taking input from fd, so a client with a backlog of
+  // lines waits in its socket buffer
+  virtual void set_reading(int fd, bool reading) = 0;
+  // Stops or resumes reporting the listener, owner only
+  virtual void set_accepting(bool accepting) = 0;
+  // Whether an event tagged so still belongs to the connection on fd
+  virtual bool is_current(int fd, uint32_t tag) const;
+  // Records a send of the front of the queue, one per connection at a time
+  void send(int fd, SendQueue &queue);
+  // Last attempt before the connection is closed, right away
+  void send_final(int fd, SendQueue &queue);
+  // Completes an IO_SENT; queue is NULL if the client is gone. -1 if the
+  // connection broke, 1 if the socket is full and reports when it drained
+  virtual int send_done(const io_event &event, SendQueue *queue);
+  // The owner's work after the events were handled, with the lock held
+  virtual void rearm();
+  // The owner's sends taken by rearm(), without the lock
+  virtual void submit();
+  // Whether another thread left work only the owner can start
+  bool needs_wake();
+  // -1 if interrupted, otherwise the number of events
+  virtual int wait(std::vector<io_event> &events, int timeout_ms) = 0;
+
+ protected:
+  EventBackend();
+
+  // The sends recorded since the last call whose connection is still there
+  void take_sends_(std::vector<io_send *> &taken);
+  // The connection is going away, its recorded send is void
+  void forget_send_(int fd);
+  bool is_sending_(const io_send *pending) const;
+
+ private:
+  void release_send_(io_send *done);
+
+  // Indexed by fd: the send recorded or in flight
+  std::vector<io_send *> sending_;
+  std::vector<io_send *> recorded_;
+  io_send *free_sends_;
+  std::vector<io_send *> sends_;
+  bool wake_needed_;
+
+  // Not used
+  EventBackend(const EventBackend &other);
+  EventBackend &operator=(const EventBackend &other);
+};
+
+}  // namespace irc
@@ -0,0 +1,190 @@
+#include "InputBuffer.hpp"
+
+#include "kernels.hpp"
+
+namespace irc {
+
+InputBuffer::InputBuffer()
+    : data_(), start_(0), scanned_(0), parsed_(0), lines_(), next_line_(0) {}
+
+InputBuffer::InputBuffer(const InputBuffer &other)
+    : data_(other.data_),
+      start_(other.start_),
+      scanned_(other.scanned_),
+      parsed_(other.parsed_),
+      lines_(other.lines_),
+      next_line_(other.next_line_) {}
+
+InputBuffer &InputBuffer::operator=(const InputBuffer &other) {
+  if (this != &other) {
+    data_ = other.data_;
+    start_ = other.start_;
+    scanned_ = other.scanned_;
+    parsed_ = other.parsed_;
+    lines_ = other.lines_;
+    next_line_ = other.next_line_;
+  }
+  return *this;
+}
+
+InputBuffer::~InputBuffer() {}
+
+void InputBuffer::append(const char *data, size_t size) {
+  // Only here may the storage move, never while messages are handed out
+  if (start_ == data_.size()) {
+    data_.clear();
+    start_ = 0;
+    scanned_ = 0;
+    parsed_ = 0;
+    lines_.clear();
+    next_line_ = 0;
+  } else if (start_ && start_ >= data_.size() - start_) {
+    data_.erase(data_.begin(), data_.begin() + start_);
+    scanned_ -= start_;
+    parsed_ -= start_;
+    for (size_t i = next_line_; i < lines_.size(); ++i)
+      lines_[i].start -= start_;
+    start_ = 0;
+  }
+  data_.insert(data_.end(), data, data + size);
+}
+
+size_t InputBuffer::size() const { return data_.size() - start_; }
+
+static const char *skip_spaces(const char *it, const char *end) {
+  while (it != end && *it == ' ') ++it;
+  return it;
+}
+
+/**
+ * @brief Splits a line into prefix, command and parameters. A parameter
+ * starting with ':' is the trailing one and takes the rest of the line; so
+ * does the 15th.
+ *
+ * @param cr the end of the line, its CRLF
+ * @return false for an empty line
+ */
+static bool split_line(const char *line, const char *cr,
+                       message_view &message) {
+  message.size = cr + 2 - line;
+  message.prefix.data = line;
+  message.prefix.size = 0;
+  message.n_params = 0;
+
+  const char *it = line;
+  if (it != cr && *it == ':') {
+    const char *space = static_cast<const char *>(memchr(it, ' ', cr - it));
+    if (space) {
+      message.prefix.data = it + 1;
+      message.prefix.size = space - it - 1;
+      it = space + 1;
+    }
+  }
+  // A lone ":text" is taken as the command itself
+  if (it != cr && *it == ':') ++it;
+  it = skip_spaces(it, cr);
+  if (it == cr) return false;
+
+  const char *word_end = it;
+  while (word_end != cr && *word_end != ' ') ++word_end;
+  message.command.data = it;
+  message.command.size = word_end - it;
+  it = skip_spaces(word_end, cr);
+
+  while (it != cr) {
+    slice &param = message.params[message.n_params++];
+    if (*it == ':' || message.n_params == MAX_PARAMS) {
+      if (*it == ':') ++it;
+      param.data = it;
+      param.size = cr - it;
+      break;
+    }
+    word_end = it;
+    while (word_end != cr && *word_end != ' ') ++word_end;
+    param.data = it;
+    param.size = word_end - it;
+    it = skip_spaces(word_end, cr);
+  }
+  return true;
+}
+
+/**
+ * @brief Cuts the complete lines out of what was appended and keeps them
+ * split. Empty lines are skipped.
+ */
+void InputBuffer::parse() {
+  if (scanned_ == data_.size()) return;
+  const char *base = &data_[0];
+  const char *end = base + data_.size();
+  message_view message;
+
+  // Resume the CRLF search where the previous call gave up
+  const char *cr;
+  while ((cr = kernels.find_crlf(base + scanned_, end))) {
+    const char *line = base + parsed_;
+    scanned_ = parsed_ = cr + 2 - base;
+    if (!split_line(line, cr, message)) continue;
+
+    parsed_line parsed;
+    parsed.start = line - base;
+    parsed.size = message.size;
+    parsed.prefix.at = message.prefix.data - line;
+    parsed.prefix.size = message.prefix.size;
+    parsed.command.at = message.command.data - line;
+    parsed.command.size = message.command.size;
+    parsed.n_params = message.n_params;
+    for (size_t i = 0; i < message.n_params; ++i) {
+      parsed.params[i].at = message.params[i].data - line;
+      parsed.params[i].size = message.params[i].size;
+    }
+    lines_.push_back(parsed);
+  }
+  // A trailing '\r' may still get its '\n'
+  scanned_ = data_.size() - (end[-1] == '\r');
+}
+
+/**
+ * @brief Hands out the next line parse() found.
+ *
+ * @param message filled with slices into this buffer
+ * @return false if there is no complete line yet
+ */
+bool InputBuffer::next_message(message_view &message) {
+  if (next_line_ == lines_.size()) {
+    // What is left is an incomplete line, or empty lines
+    start_ = parsed_;
+    lines_.clear();
+    next_line_ = 0;
+    return false;
+  }
+  const parsed_line &parsed = lines_[next_line_++];
+  const char *line = &data_[parsed.start];
+  start_ = parsed.start + parsed.size;
+
+  message.size = parsed.size;
+  message.prefix.data = line + parsed.prefix.at;
+  message.prefix.size = parsed.prefix.size;
+  message.command.data = line + parsed.command.at;
+  message.command.size = parsed.command.size;
+  message.n_params = parsed.n_params;
+  for (size_t i = 0; i < parsed.n_params; ++i) {
+    message.params[i].data = line + parsed.params[i].at;
+    message.params[i].size = parsed.params[i].size;
+  }
+  return true;
+}
+
+/**
+ * @brief Copies a message into the argument vector the command handlers take,
+ * out[0] being the command. The vector is meant to be reused, so the strings
+ * keep their storage from one message to the next.
+ */
+void message_view_to_vector(const message_view &message,
+                            std::vector<std::string> &out) {
+  out.resize(message.n_params + 1);
+  out[0].assign(message.command.data, message.command.size);
+  for (size_t i = 0; i < message.n_params; ++i)
+    out[i + 1].assign(message.params[i].data, message.params[i].size);
+}
+
+}  // namespace irc
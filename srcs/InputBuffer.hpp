@@ -0,0 +1,78 @@
+#pragma once
+
+#include "include.hpp"
+
+#define MAX_PARAMS 15
+
+namespace irc {
+
+// A piece of the input buffer, not NUL terminated
+struct slice {
+  const char *data;
+  size_t size;
+};
+
+/**
+ * @brief One parsed line. The slices point into the InputBuffer it came from
+ * and stay valid until the next append() on that buffer.
+ */
+struct message_view {
+  slice prefix;
+  slice command;
+  slice params[MAX_PARAMS];
+  size_t n_params;
+  // Bytes of the line, CRLF included
+  size_t size;
+};
+
+/**
+ * @brief Bytes received from a client that were not consumed yet. Lines are
+ * cut out in place: every byte is scanned for the CRLF only once, consumed
+ * lines just move a start offset, and the front is compacted on append once
+ * it is the larger part of the buffer.
+ *
+ * parse() does the scanning and splitting, right after the read and without
+ * the server lock; next_message() only hands out what it found.
+ */
+class InputBuffer {
+ public:
+  InputBuffer();
+  InputBuffer(const InputBuffer &other);
+  InputBuffer &operator=(const InputBuffer &other);
+  ~InputBuffer();
+
+  void append(const char *data, size_t size);
+  // Splits the complete lines appended since the last call
+  void parse();
+  bool next_message(message_view &message);
+  size_t size() const;
+
+ private:
+  // Part of a line, relative to its start
+  struct span {
+    uint32_t at;
+    uint32_t size;
+  };
+  // A line parse() split, by offsets: the storage may move on append()
+  struct parsed_line {
+    size_t start;
+    uint32_t size;
+    span prefix;
+    span command;
+    span params[MAX_PARAMS];
+    uint32_t n_params;
+  };
+
+  std::vector<char> data_;
+  size_t start_;
+  size_t scanned_;
+  // End of the last complete line
+  size_t parsed_;
+  std::vector<parsed_line> lines_;
+  size_t next_line_;
+};
+
+void message_view_to_vector(const message_view &message,
+                            std::vector<std::string> &out);
+
+}  // namespace irc
@@ -0,0 +1,118 @@
+#include "MemberTable.hpp"
+
+// Slots of the smallest index; the index is kept at most half full
+#define MEMBER_TABLE_MIN_SLOTS 8
+
+namespace irc {
+
+MemberTable::MemberTable() : members_(), index_() {}
+
+MemberTable::MemberTable(const MemberTable &other)
+    : members_(other.members_), index_(other.index_) {}
+
+MemberTable &MemberTable::operator=(const MemberTable &other) {
+  if (this != &other) {
+    members_ = other.members_;
+    index_ = other.index_;
+  }
+  return *this;
+}
+
+MemberTable::~MemberTable() {}
+
+size_t MemberTable::home_slot_(client_id id) const {
+  // Fibonacci hashing spreads consecutive fds over the whole index
+  uint32_t hash = ((uint32_t)id ^ (uint32_t)(id >> 32)) * 2654435769u;
+  hash ^= hash >> 16;
+  return hash & (index_.size() - 1);
+}
+
+/**
+ * @brief Probes for the id.
+ *
+ * @return the slot holding the id, or the free slot ending the probe
+ */
+size_t MemberTable::find_slot_(client_id id) const {
+  size_t mask = index_.size() - 1;
+  size_t slot = home_slot_(id);
+  while (index_[slot] && members_[index_[slot] - 1].id != id)
+    slot = (slot + 1) & mask;
+  return slot;
+}
+
+void MemberTable::rebuild_index_(size_t slots) {
+  index_.assign(slots, 0);
+  for (size_t i = 0; i < members_.size(); ++i)
+    index_[find_slot_(members_[i].id)] = i + 1;
+}
+
+bool MemberTable::insert(client_id id, uint8_t flags) {
+  if (index_.empty()) index_.assign(MEMBER_TABLE_MIN_SLOTS, 0);
+
+  size_t slot = find_slot_(id);
+  if (index_[slot]) return false;
+
+  member record;
+  record.id = id;
+  record.flags = flags;
+  record.ban_epoch = 0;
+  record.banned = false;
+  members_.push_back(record);
+  index_[slot] = members_.size();
+  if (members_.size() * 2 > index_.size()) rebuild_index_(index_.size() * 2);
+  return true;
+}
+
+bool MemberTable::erase(client_id id) {
+  if (members_.empty()) return false;
+
+  size_t slot = find_slot_(id);
+  if (!index_[slot]) return false;
+
+  // Move the last record into the hole and repoint its slot
+  size_t position = index_[slot] - 1;
+  if (position != members_.size() - 1) {
+    size_t moved_slot = find_slot_(members_.back().id);
+    members_[position] = members_.back();
+    index_[moved_slot] = position + 1;
+  }
+  members_.pop_back();
+
+  // Backward shift deletion: pull later entries of the probe sequence into
+  // the free slot so no tombstones are needed
+  size_t mask = index_.size() - 1;
+  size_t hole = slot;
+  size_t next = (hole + 1) & mask;
+  while (index_[next]) {
+    size_t home = home_slot_(members_[index_[next] - 1].id);
+    // Can the entry at next live in the hole? Only if its home slot is not
+    // in the cyclic range (hole, next]
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      index_[hole] = index_[next];
+      hole = next;
+    }
+    next = (next + 1) & mask;
+  }
+  index_[hole] = 0;
+  return true;
+}
+
+member *MemberTable::find(client_id id) {
+  if (members_.empty()) return NULL;
+  size_t slot = find_slot_(id);
+  return index_[slot] ? &members_[index_[slot] - 1] : NULL;
+}
+
+const member *MemberTable::find(client_id id) const {
+  if (members_.empty()) return NULL;
+  size_t slot = find_slot_(id);
+  return index_[slot] ? &members_[index_[slot] - 1] : NULL;
+}
+
+size_t MemberTable::size() const { return members_.size(); }
+
+bool MemberTable::empty() const { return members_.empty(); }
+
+const std::vector<member> &MemberTable::members() const { return members_; }
+
+}  // namespace irc
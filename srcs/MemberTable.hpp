@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Client.hpp"
+#include "include.hpp"
+
+#define MEMBER_OPERATOR 0x01
+#define MEMBER_SPEAKER 0x02
+
+namespace irc {
+
+// One member of a channel with its +o/+v flags and its cached ban verdict
+struct member {
+  client_id id;
+  uint8_t flags;
+  // Ban list epoch the verdict was taken at, 0 if there is none
+  uint32_t ban_epoch;
+  bool banned;
+};
+
+/**
+ * @brief The members of a channel. The records are kept dense in one array,
+ * which is what a broadcast walks; a linear probing index over that array
+ * makes lookup, join and part O(1). Removing swaps the last record into the
+ * hole, so the order of members is not kept.
+ */
+class MemberTable {
+ public:
+  MemberTable();
+  MemberTable(const MemberTable &other);
+  MemberTable &operator=(const MemberTable &other);
+  ~MemberTable();
+
+  bool insert(client_id id, uint8_t flags);
+  bool erase(client_id id);
+  member *find(client_id id);
+  const member *find(client_id id) const;
+  size_t size() const;
+  bool empty() const;
+  const std::vector<member> &members() const;
+
+ private:
+  size_t home_slot_(client_id id) const;
+  size_t find_slot_(client_id id) const;
+  void rebuild_index_(size_t slots);
+
+  std::vector<member> members_;
+  // Position in members_ + 1 per slot, 0 is a free slot
+  std::vector<size_t> index_;
+};
+
+}  // namespace irc
@@ -0,0 +1,95 @@
+#include "Metrics.hpp"
+
+namespace irc {
+
+Histogram::Histogram() : count_(0), sum_us_(0) {
+  memset(buckets_, 0, sizeof(buckets_));
+}
+
+Histogram::Histogram(const Histogram &other)
+    : count_(other.count_), sum_us_(other.sum_us_) {
+  memcpy(buckets_, other.buckets_, sizeof(buckets_));
+}
+
+Histogram &Histogram::operator=(const Histogram &other) {
+  if (this != &other) {
+    memcpy(buckets_, other.buckets_, sizeof(buckets_));
+    count_ = other.count_;
+    sum_us_ = other.sum_us_;
+  }
+  return *this;
+}
+
+Histogram::~Histogram() {}
+
+void Histogram::observe(uint64_t us) {
+  // The smallest power of two >= us
+  size_t bucket = us <= 1 ? 0 : 64 - __builtin_clzl((unsigned long)(us - 1));
+  ++buckets_[std::min(bucket, (size_t)HISTOGRAM_BUCKETS - 1)];
+  ++count_;
+  sum_us_ += us;
+}
+
+uint64_t Histogram::count() const { return count_; }
+
+uint64_t Histogram::quantile(double q) const {
+  if (!count_) return 0;
+
+  uint64_t rank = (uint64_t)(q * count_ + 0.5);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank && seen) return (uint64_t)1 << i;
+  }
+  return (uint64_t)1 << (HISTOGRAM_BUCKETS - 1);
+}
+
+// Prometheus wants seconds
+static void write_seconds(std::ostream &out, uint64_t us) {
+  char fraction[7];
+  uint64_t rest = us % 1000000;
+  for (int i = 5; i >= 0; --i, rest /= 10) fraction[i] = '0' + rest % 10;
+  fraction[6] = '\0';
+  out << (unsigned long)(us / 1000000) << '.' << fraction;
+}
+
+void Histogram::write(std::ostream &out, const char *name,
+                      const std::string &labels) const {
+  std::string separator = labels.empty() ? "" : ",";
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+    cumulative += buckets_[i];
+    out << name << "_bucket{" << labels << separator << "le=\"";
+    if (i + 1 < HISTOGRAM_BUCKETS)
+      write_seconds(out, (uint64_t)1 << i);
+    else
+      out << "+Inf";
+    out << "\"} " << (unsigned long)cumulative << '\n';
+  }
+  std::string braces = labels.empty() ? "" : "{" + labels + "}";
+  out << name << "_sum" << braces << ' ';
+  write_seconds(out, sum_us_);
+  out << '\n' << name << "_count" << braces << ' ' << (unsigned long)count_
+      << '\n';
+}
+
+uint64_t monotonic_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void write_metric_header(std::ostream &out, const char *name, const char *type,
+                         const char *help) {
+  out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' '
+      << type << '\n';
+}
+
+void write_metric(std::ostream &out, const char *name,
+                  const std::string &labels, uint64_t value) {
+  out << name;
+  if (!labels.empty()) out << '{' << labels << '}';
+  out << ' ' << (unsigned long)value << '\n';
+}
+
+}  // namespace irc
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "include.hpp"
+
+// Latency buckets up to 1us, 2us, 4us ... 2^22us (4.2s), then the rest
+#define HISTOGRAM_BUCKETS 24
+
+namespace irc {
+
+/**
+ * @brief A latency distribution over power-of-two buckets of microseconds,
+ * in the shape of a Prometheus histogram. Observing a value is a bit scan and
+ * three additions, cheap enough to stay on for every command.
+ */
+class Histogram {
+ public:
+  Histogram();
+  Histogram(const Histogram &other);
+  Histogram &operator=(const Histogram &other);
+  ~Histogram();
+
+  void observe(uint64_t us);
+  uint64_t count() const;
+  // Upper bound (us) of the bucket the q quantile falls into, 0 if empty
+  uint64_t quantile(double q) const;
+  // The _bucket, _sum and _count series; labels go inside the braces
+  void write(std::ostream &out, const char *name,
+             const std::string &labels) const;
+
+ private:
+  // Not cumulative, the last one has no upper bound
+  uint64_t buckets_[HISTOGRAM_BUCKETS];
+  uint64_t count_;
+  uint64_t sum_us_;
+};
+
+// Microseconds on the monotonic clock, precise enough for latencies
+uint64_t monotonic_us();
+
+// The # HELP and # TYPE lines of a metric in the Prometheus text format
+void write_metric_header(std::ostream &out, const char *name, const char *type,
+                         const char *help);
+void write_metric(std::ostream &out, const char *name,
+                  const std::string &labels, uint64_t value);
+
+}  // namespace irc
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "include.hpp"
+
+// Slots of an empty registry; the table is kept at most half full
+#define NAME_REGISTRY_MIN_SLOTS 16
+
+namespace irc {
+
+/**
+ * @brief Maps nicknames or channel names to values, case-insensitively as
+ * defined by RFC1459. A name is casefolded and hashed once: on insert both
+ * are stored with the entry, on lookup only the query is folded. A lookup
+ * is then one hash, a probe over stored hashes and a memcmp of the folded
+ * bytes. Entries live on the heap, so a value's address is stable until it
+ * is erased.
+ */
+template <class T>
+class NameRegistry {
+ public:
+  NameRegistry() : slots_(), size_(0) {}
+  ~NameRegistry() { clear(); }
+
+  T *find(const std::string &name) {
+    std::string key = irc_casefold(name);
+    entry *found = slots_.empty() ? NULL : slots_[find_slot_(key, hash_(key))];
+    return found ? &found->value : NULL;
+  }
+
+  const T *find(const std::string &name) const {
+    return const_cast<NameRegistry *>(this)->find(name);
+  }
+
+  bool count(const std::string &name) const { return find(name) != NULL; }
+
+  /**
+   * @brief Adds the name unless it is already known.
+   *
+   * @return the value stored for the name
+   */
+  T &insert(const std::string &name, const T &value) {
+    if ((size_ + 1) * 2 > slots_.size())
+      rehash_(slots_.empty() ? NAME_REGISTRY_MIN_SLOTS : slots_.size() * 2);
+
+    std::string key = irc_casefold(name);
+    size_t hash = hash_(key);
+    size_t slot = find_slot_(key, hash);
+    if (!slots_[slot]) {
+      entry *created = new entry(key, hash, value);
+      slots_[slot] = created;
+      ++size_;
+    }
+    return slots_[slot]->value;
+  }
+
+  bool erase(const std::string &name) {
+    if (slots_.empty()) return false;
+
+    std::string key = irc_casefold(name);
+    size_t slot = find_slot_(key, hash_(key));
+    if (!slots_[slot]) return false;
+    delete slots_[slot];
+    --size_;
+
+    // Backward shift deletion, see MemberTable::erase
+    size_t mask = slots_.size() - 1;
+    size_t hole = slot;
+    size_t next = (hole + 1) & mask;
+    while (slots_[next]) {
+      size_t home = slots_[next]->hash & mask;
+      if (((next - home) & mask) >= ((next - hole) & mask)) {
+        slots_[hole] = slots_[next];
+        hole = next;
+      }
+      next = (next + 1) & mask;
+    }
+    slots_[hole] = NULL;
+    return true;
+  }
+
+  void clear() {
+    for (size_t i = 0; i < slots_.size(); ++i) delete slots_[i];
+    slots_.clear();
+    size_ = 0;
+  }
+
+  size_t size() const { return size_; }
+
+ private:
+  struct entry {
+    entry(const std::string &key, size_t hash, const T &value)
+        : key(key), hash(hash), value(value) {}
+
+    // Casefolded name
+    std::string key;
+    size_t hash;
+    T value;
+  };
+
+  static size_t hash_(const std::string &key) {
+    // FNV-1a
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < key.size(); ++i) {
+      hash ^= (unsigned char)key[i];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  // The slot holding the key or the free slot ending its probe
+  size_t find_slot_(const std::string &key, size_t hash) const {
+    size_t mask = slots_.size() - 1;
+    size_t slot = hash & mask;
+    while (slots_[slot]) {
+      const entry *current = slots_[slot];
+      if (current->hash == hash && current->key.size() == key.size() &&
+          !memcmp(current->key.data(), key.data(), key.size()))
+        break;
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  void rehash_(size_t slots) {
+    std::vector<entry *> old;
+    old.swap(slots_);
+    slots_.assign(slots, NULL);
+    for (size_t i = 0; i < old.size(); ++i) {
+      if (old[i]) slots_[find_slot_(old[i]->key, old[i]->hash)] = old[i];
+    }
+  }
+
+  std::vector<entry *> slots_;
+  size_t size_;
+
+  // Not used
+  NameRegistry(const NameRegistry &other);
+  NameRegistry &operator=(const NameRegistry &other);
+};
+
+}  // namespace irc
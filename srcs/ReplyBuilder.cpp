@@ -0,0 +1,79 @@
+#include "ReplyBuilder.hpp"
+
+namespace irc {
+
+ReplyBuilder::ReplyBuilder(Client &client)
+    : queue_(client.get_send_queue()),
+      bytes_(queue_.open_block()),
+      start_(bytes_.size()),
+      sent_(false) {}
+
+ReplyBuilder::ReplyBuilder(Client &client, int number)
+    : queue_(client.get_send_queue()),
+      bytes_(queue_.open_block()),
+      start_(bytes_.size()),
+      sent_(false) {
+  const std::string &prefix = client.get_reply_prefix();
+  bytes_.append(prefix);
+  // The digits follow ":<server> ", a server name has no spaces
+  size_t digits = start_ + prefix.find(' ') + 1;
+  bytes_[digits] = '0' + number / 100 % 10;
+  bytes_[digits + 1] = '0' + number / 10 % 10;
+  bytes_[digits + 2] = '0' + number % 10;
+}
+
+ReplyBuilder::~ReplyBuilder() {
+  if (!sent_) bytes_.resize(start_);
+}
+
+ReplyBuilder &ReplyBuilder::operator<<(const std::string &text) {
+  bytes_.append(text);
+  return *this;
+}
+
+ReplyBuilder &ReplyBuilder::operator<<(const char *text) {
+  bytes_.append(text);
+  return *this;
+}
+
+ReplyBuilder &ReplyBuilder::operator<<(char c) {
+  bytes_.push_back(c);
+  return *this;
+}
+
+ReplyBuilder &ReplyBuilder::operator<<(int number) {
+  return *this << (long)number;
+}
+
+ReplyBuilder &ReplyBuilder::operator<<(long number) {
+  if (number < 0) {
+    bytes_.push_back('-');
+    append_unsigned_(-(unsigned long)number);
+  } else {
+    append_unsigned_(number);
+  }
+  return *this;
+}
+
+ReplyBuilder &ReplyBuilder::operator<<(unsigned long number) {
+  append_unsigned_(number);
+  return *this;
+}
+
+void ReplyBuilder::append_unsigned_(unsigned long number) {
+  char digits[24];
+  size_t n = 0;
+  do {
+    digits[n++] = '0' + number % 10;
+    number /= 10;
+  } while (number);
+  while (n) bytes_.push_back(digits[--n]);
+}
+
+void ReplyBuilder::send() {
+  bytes_.append("\r\n", 2);
+  queue_.commit(bytes_.size() - start_);
+  sent_ = true;
+}
+
+}  // namespace irc
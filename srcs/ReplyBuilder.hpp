@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Client.hpp"
+#include "include.hpp"
+
+namespace irc {
+
+/**
+ * @brief Formats one message straight into the open block of a client's send
+ * queue, without a stringstream or a temporary string. send() appends the
+ * CRLF and hands the message to the queue; a builder destroyed without
+ * send() takes its bytes back out.
+ *
+ * Only one builder per queue may be alive at a time.
+ */
+class ReplyBuilder {
+ public:
+  // A message as is
+  explicit ReplyBuilder(Client &client);
+  // A numeric reply, starting with the client's cached reply prefix
+  ReplyBuilder(Client &client, int number);
+  ~ReplyBuilder();
+
+  ReplyBuilder &operator<<(const std::string &text);
+  ReplyBuilder &operator<<(const char *text);
+  ReplyBuilder &operator<<(char c);
+  ReplyBuilder &operator<<(int number);
+  ReplyBuilder &operator<<(long number);
+  ReplyBuilder &operator<<(unsigned long number);
+  void send();
+
+ private:
+  ReplyBuilder(const ReplyBuilder &other);             // Not used
+  ReplyBuilder &operator=(const ReplyBuilder &other);  // Not used
+
+  void append_unsigned_(unsigned long number);
+
+  SendQueue &queue_;
+  std::string &bytes_;
+  // Where this message starts in the block
+  size_t start_;
+  bool sent_;
+};
+
+}  // namespace irc
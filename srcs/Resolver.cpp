@@ -0,0 +1,151 @@
+#include "Resolver.hpp"
+
+namespace irc {
+
+Resolver::Resolver() : cache_ttl_(0), stopping_(false) {
+  pthread_mutex_init(&lock_, NULL);
+  pthread_cond_init(&jobs_available_, NULL);
+}
+
+Resolver::~Resolver() {
+  stop();
+  pthread_cond_destroy(&jobs_available_);
+  pthread_mutex_destroy(&lock_);
+}
+
+void Resolver::start(size_t n_threads, std::time_t cache_ttl) {
+  cache_ttl_ = cache_ttl;
+  for (size_t i = 0; i < n_threads; ++i) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, &Resolver::worker_main_, this) != 0) {
+      stop();
+      throw std::runtime_error("Failed to start resolver thread");
+    }
+    threads_.push_back(thread);
+  }
+}
+
+void Resolver::stop() {
+  pthread_mutex_lock(&lock_);
+  stopping_ = true;
+  pthread_cond_broadcast(&jobs_available_);
+  pthread_mutex_unlock(&lock_);
+
+  for (size_t i = 0; i < threads_.size(); ++i)
+    pthread_join(threads_[i], NULL);
+  threads_.clear();
+}
+
+bool Resolver::enabled() const { return !threads_.empty(); }
+
+/**
+ * @brief Looks for a cached, unexpired result for the address
+ *
+ * @param addr the client's address
+ * @param hostname set to the cached hostname (the IP if it has no PTR record)
+ * @return true on a cache hit
+ */
+bool Resolver::lookup_cache(const struct in_addr &addr,
+                            std::string &hostname) {
+  bool hit = false;
+
+  pthread_mutex_lock(&lock_);
+  std::map<in_addr_t, cache_entry>::iterator it = cache_.find(addr.s_addr);
+  if (it != cache_.end()) {
+    if (it->second.expires > std::time(NULL)) {
+      hostname = it->second.hostname;
+      hit = true;
+    } else {
+      cache_.erase(it);
+    }
+  }
+  pthread_mutex_unlock(&lock_);
+  return hit;
+}
+
+/**
+ * @brief Queues a reverse lookup. When it is done, the result is kept for
+ * collect() and wake_fd (an eventfd) is signalled.
+ */
+void Resolver::submit(client_id client, int wake_fd,
+                      const struct sockaddr_in &addr) {
+  resolver_job job;
+  job.client = client;
+  job.wake_fd = wake_fd;
+  job.addr = addr;
+
+  pthread_mutex_lock(&lock_);
+  jobs_.push_back(job);
+  pthread_cond_signal(&jobs_available_);
+  pthread_mutex_unlock(&lock_);
+}
+
+void Resolver::collect(std::vector<resolved_host> &results) {
+  pthread_mutex_lock(&lock_);
+  results.swap(results_);
+  results_.clear();
+  pthread_mutex_unlock(&lock_);
+}
+
+void *Resolver::worker_main_(void *arg) {
+  static_cast<Resolver *>(arg)->worker_loop_();
+  return NULL;
+}
+
+void Resolver::worker_loop_() {
+  char hostname[NI_MAXHOST];
+  char ip_addr[INET_ADDRSTRLEN];
+
+  pthread_mutex_lock(&lock_);
+  while (true) {
+    while (jobs_.empty() && !stopping_)
+      pthread_cond_wait(&jobs_available_, &lock_);
+    if (stopping_) break;
+
+    resolver_job job = jobs_.front();
+    jobs_.pop_front();
+    pthread_mutex_unlock(&lock_);
+
+    // The slow part, without holding anything
+    resolved_host result;
+    result.client = job.client;
+    inet_ntop(AF_INET, &job.addr.sin_addr, ip_addr, sizeof(ip_addr));
+    result.ip_addr = ip_addr;
+    if (getnameinfo((struct sockaddr *)&job.addr, sizeof(job.addr), hostname,
+                    NI_MAXHOST, NULL, 0, NI_NAMEREQD) == 0)
+      result.hostname = hostname;
+    else
+      result.hostname = result.ip_addr;
+
+    pthread_mutex_lock(&lock_);
+    store_cache_(job.addr.sin_addr.s_addr, result.hostname);
+    results_.push_back(result);
+    uint64_t one = 1;
+    if (write(job.wake_fd, &one, sizeof(one)) < 0) continue;
+  }
+  pthread_mutex_unlock(&lock_);
+}
+
+void Resolver::store_cache_(in_addr_t addr, const std::string &hostname) {
+  if (!cache_ttl_) return;
+
+  // Expired entries are only dropped on lookup; sweep once the cache is big
+  if (cache_.size() >= RESOLVER_CACHE_SIZE) {
+    std::time_t now = std::time(NULL);
+    std::map<in_addr_t, cache_entry>::iterator it = cache_.begin();
+    while (it != cache_.end()) {
+      if (it->second.expires <= now)
+        cache_.erase(it++);
+      else
+        ++it;
+    }
+    if (cache_.size() >= RESOLVER_CACHE_SIZE) cache_.clear();
+  }
+
+  cache_entry entry;
+  entry.hostname = hostname;
+  entry.expires = std::time(NULL) + cache_ttl_;
+  cache_[addr] = entry;
+}
+
+}  // namespace irc
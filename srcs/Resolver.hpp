@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Client.hpp"
+#include "include.hpp"
+
+#define RESOLVER_CACHE_SIZE 65536
+
+namespace irc {
+
+// Results go to the client by id: its fd may be taken by a new connection
+// before the lookup is done
+struct resolver_job {
+  client_id client;
+  int wake_fd;
+  struct sockaddr_in addr;
+};
+
+struct resolved_host {
+  client_id client;
+  std::string ip_addr;
+  std::string hostname;
+};
+
+/**
+ * @brief Reverse DNS outside the event loop. Lookups run on a small pool of
+ * threads, finished ones are collected by the server under its own lock.
+ * Results (including failed lookups) are cached per address for a TTL, so a
+ * reconnect storm from the same hosts doesn't hit DNS again.
+ */
+class Resolver {
+ public:
+  Resolver();
+  ~Resolver();
+
+  void start(size_t n_threads, std::time_t cache_ttl);
+  void stop();
+  bool enabled() const;
+  bool lookup_cache(const struct in_addr &addr, std::string &hostname);
+  void submit(client_id client, int wake_fd, const struct sockaddr_in &addr);
+  void collect(std::vector<resolved_host> &results);
+
+ private:
+  // Not used
+  Resolver(const Resolver &other);
+  Resolver &operator=(const Resolver &other);
+
+  struct cache_entry {
+    std::string hostname;
+    std::time_t expires;
+  };
+
+  static void *worker_main_(void *arg);
+  void worker_loop_();
+  void store_cache_(in_addr_t addr, const std::string &hostname);
+
+  pthread_mutex_t lock_;
+  pthread_cond_t jobs_available_;
+  std::vector<pthread_t> threads_;
+  std::deque<resolver_job> jobs_;
+  std::vector<resolved_host> results_;
+  std::map<in_addr_t, cache_entry> cache_;
+  std::time_t cache_ttl_;
+  bool stopping_;
+};
+
+}  // namespace irc
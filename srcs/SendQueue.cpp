@@ -0,0 +1,175 @@
+#include "SendQueue.hpp"
+
+namespace irc {
+
+// Only touched with the state lock held, like the queues themselves
+static std::vector<SharedBuffer> block_pool;
+static uint64_t total_sent = 0;
+
+SendQueue::SendQueue()
+    : chunks_(),
+      deferred_(),
+      tail_open_(false),
+      offset_(0),
+      size_(0),
+      epoch_(0) {}
+
+// A copy shares the blocks, so neither may append to them any more
+SendQueue::SendQueue(const SendQueue &other)
+    : chunks_(other.chunks_),
+      deferred_(other.deferred_),
+      tail_open_(false),
+      offset_(other.offset_),
+      size_(other.size_),
+      epoch_(other.epoch_) {}
+
+SendQueue &SendQueue::operator=(const SendQueue &other) {
+  if (this != &other) {
+    chunks_ = other.chunks_;
+    deferred_ = other.deferred_;
+    tail_open_ = false;
+    offset_ = other.offset_;
+    size_ = other.size_;
+    epoch_ = other.epoch_;
+  }
+  return *this;
+}
+
+SendQueue::~SendQueue() {}
+
+void SendQueue::push(const std::string &message) {
+  push(SharedBuffer(message));
+}
+
+void SendQueue::push(const SharedBuffer &message) {
+  chunks_.push_back(message);
+  tail_open_ = false;
+  size_ += message.size();
+}
+
+void SendQueue::defer(const SharedBuffer &message) {
+  deferred_.push_back(message);
+  size_ += message.size();
+}
+
+SharedBuffer SendQueue::take_block_() {
+  if (block_pool.empty()) return SharedBuffer::with_capacity(SEND_BLOCK_SIZE);
+  SharedBuffer block = block_pool.back();
+  block_pool.pop_back();
+  return block;
+}
+
+void SendQueue::recycle_block_(SharedBuffer &block) {
+  if (block_pool.size() >= SEND_BLOCK_POOL_MAX || !block.is_unique() ||
+      block.writable_bytes().capacity() < SEND_BLOCK_SIZE)
+    return;
+  block.writable_bytes().clear();
+  block_pool.push_back(block);
+}
+
+/**
+ * @brief Returns the bytes of the open block at the end of the queue,
+ * opening a new one if the last chunk is shared or the block is full. A reply
+ * longer than the room left just grows the block.
+ */
+std::string &SendQueue::open_block() {
+  if (!tail_open_ || !chunks_.back().is_unique() ||
+      chunks_.back().size() >= SEND_BLOCK_SIZE) {
+    chunks_.push_back(take_block_());
+    tail_open_ = true;
+  }
+  return chunks_.back().writable_bytes();
+}
+
+void SendQueue::commit(size_t bytes) { size_ += bytes; }
+
+/**
+ * @brief Writes as much of the pending output as the socket accepts right
+ * now. Never blocks: a full socket buffer just leaves the rest queued.
+ *
+ * @param fd the client's (non-blocking) socket
+ * @return 0 if the socket is still usable, -1 if the connection is broken
+ */
+int SendQueue::flush(int fd) {
+  struct iovec iov[SEND_IOV_MAX];
+  struct msghdr header;
+  memset(&header, 0, sizeof(header));
+  header.msg_iov = iov;
+
+  // Until the socket is full: EPOLLOUT is edge triggered
+  while (!empty()) {
+    size_t count = gather(iov, NULL, SEND_IOV_MAX);
+    size_t wanted = 0;
+    for (size_t i = 0; i < count; ++i) wanted += iov[i].iov_len;
+
+    // sendmsg() instead of writev() for MSG_NOSIGNAL
+    header.msg_iovlen = count;
+    ssize_t sent = sendmsg(fd, &header, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+      return -1;
+    }
+    consume(sent);
+    if ((size_t)sent < wanted) break;
+  }
+  return 0;
+}
+
+size_t SendQueue::gather(struct iovec *iov, SharedBuffer *hold, size_t max) {
+  // The deferred messages are next once everything else went out; a batch
+  // at a time, so what is pushed meanwhile still goes before the rest
+  if (chunks_.empty()) {
+    while (!deferred_.empty() && chunks_.size() < max) {
+      chunks_.push_back(deferred_.front());
+      deferred_.pop_front();
+    }
+  }
+
+  size_t count = 0;
+  for (std::deque<SharedBuffer>::iterator it = chunks_.begin();
+       it != chunks_.end() && count < max; ++it, ++count) {
+    size_t skip = count ? 0 : offset_;
+    iov[count].iov_base = const_cast<char *>(it->data() + skip);
+    iov[count].iov_len = it->size() - skip;
+    if (hold) hold[count] = *it;
+  }
+  return count;
+}
+
+/**
+ * @brief Drops the chunks that went out completely and remembers where the
+ * rest starts
+ */
+void SendQueue::consume(size_t bytes) {
+  total_sent += bytes;
+  size_ -= bytes;
+  size_t left = bytes + offset_;
+  while (!chunks_.empty() && left >= chunks_.front().size()) {
+    left -= chunks_.front().size();
+    if (chunks_.size() == 1) tail_open_ = false;
+    recycle_block_(chunks_.front());
+    chunks_.pop_front();
+  }
+  offset_ = left;
+}
+
+uint32_t SendQueue::epoch() const { return epoch_; }
+
+bool SendQueue::empty() const { return size_ == 0; }
+
+size_t SendQueue::size() const { return size_; }
+
+bool SendQueue::has_deferred() const { return !deferred_.empty(); }
+
+uint64_t SendQueue::bytes_sent() { return total_sent; }
+
+void SendQueue::clear() {
+  chunks_.clear();
+  deferred_.clear();
+  tail_open_ = false;
+  offset_ = 0;
+  size_ = 0;
+  ++epoch_;
+}
+
+}  // namespace irc
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "SharedBuffer.hpp"
+#include "include.hpp"
+
+// Chunks handed to a single writev()
+#define SEND_IOV_MAX 64
+// Replies are formatted into blocks of this size
+#define SEND_BLOCK_SIZE 2048
+// Sent blocks kept for reuse, shared by all queues
+#define SEND_BLOCK_POOL_MAX 256
+
+namespace irc {
+
+/**
+ * @brief Outgoing bytes of one client, as a list of references to (possibly
+ * shared) messages. Pending chunks are handed to the socket with a single
+ * writev() per flush, so a peer that stops reading only ever fills its own
+ * queue.
+ *
+ * Replies to this client alone are formatted straight into the block at the
+ * end of the queue (see ReplyBuilder). Blocks that went out are kept in a
+ * pool and reused, so a reply costs no allocation.
+ *
+ * Deferred messages wait behind everything pushed, also what is pushed after
+ * them, and are only sent once the rest of the queue went out.
+ */
+class SendQueue {
+ public:
+  SendQueue();
+  SendQueue(const SendQueue &other);
+  SendQueue &operator=(const SendQueue &other);
+  ~SendQueue();
+
+  void push(const std::string &message);
+  void push(const SharedBuffer &message);
+  void defer(const SharedBuffer &message);
+  // The block to append a reply to; commit() the bytes appended
+  std::string &open_block();
+  void commit(size_t bytes);
+  int flush(int fd);
+  // The front of the queue as iovecs, for a send that completes later; hold
+  // (if given) gets references that keep the bytes alive until then
+  size_t gather(struct iovec *iov, SharedBuffer *hold, size_t max);
+  // Drops bytes that were sent from the front
+  void consume(size_t bytes);
+  // Changes with every clear(), a pending gather() is void after it
+  uint32_t epoch() const;
+  bool empty() const;
+  // Bytes queued, the deferred ones included
+  size_t size() const;
+  bool has_deferred() const;
+  void clear();
+  // Bytes all queues sent since startup
+  static uint64_t bytes_sent();
+
+ private:
+  static SharedBuffer take_block_();
+  static void recycle_block_(SharedBuffer &block);
+
+  std::deque<SharedBuffer> chunks_;
+  std::deque<SharedBuffer> deferred_;
+  // The last chunk is a block replies are appended to
+  bool tail_open_;
+  // Bytes of the front chunk that were already sent
+  size_t offset_;
+  size_t size_;
+  uint32_t epoch_;
+};
+
+}  // namespace irc
@@ -2,76 +2,195 @@
 
 namespace irc {
 
-Server::Server() : running_(false), creation_time_(std::time(NULL)) {
+Server::Server()
+    : current_reactor_(NULL),
+      shutdown_fd_(-1),
+      running_(false),
+      metrics_fd_(-1),
+      stall_logged_ms_(0),
+      stalls_suppressed_(0),
+      clock_ms_(0),
+      creation_time_(std::time(NULL)),
+      motd_mtime_(0),
+      motd_checked_(0) {
   server_name_ = "ft_irc";
   operator_password_ = "garfield";
-  init_function_vector_();
-  init_error_codes_();
+  memset(&counters_, 0, sizeof(counters_));
+  pthread_mutex_init(&state_lock_, NULL);
+  init_command_table_();
+  init_numeric_texts_();
+  init_welcome_burst_();
 }
 
 Server::~Server() {
-  if (socket_fd_ > 0) close(socket_fd_);
+  for (size_t i = 0; i < reactors_.size(); ++i) {
+    delete reactors_[i].backend;
+    // Without SO_REUSEPORT all reactors share the first listener
+    if (reactors_[i].listen_fd > 0 &&
+        (i == 0 || reactors_[i].listen_fd != reactors_[0].listen_fd))
+      close(reactors_[i].listen_fd);
+    if (reactors_[i].wake_fd > 0) close(reactors_[i].wake_fd);
+    if (reactors_[i].spare_fd >= 0) close(reactors_[i].spare_fd);
+    for (size_t j = 0; j < reactors_[i].inputs.size(); ++j)
+      delete reactors_[i].inputs[j];
+  }
+  if (shutdown_fd_ > 0) close(shutdown_fd_);
+  if (metrics_fd_ >= 0) close(metrics_fd_);
+  pthread_mutex_destroy(&state_lock_);
 }
 
-void Server::init(int port, std::string password) {
-  struct sockaddr_in server_addr;
-
+void Server::init(int port, std::string password,
+                  const ServerConfig &config) {
   if (running_) throw std::runtime_error("Server already running.");
 
   password_ = password;
+  config_ = config;
+  raise_fd_limit_();
+  update_clock_();
+  load_motd_();
+
+  if ((shutdown_fd_ = eventfd(0, EFD_NONBLOCK)) < 0)
+    throw std::runtime_error("Could not create shutdown eventfd");
+
+  // One listener per reactor: the kernel spreads new connections over them
+  for (size_t i = 0; i < config_.workers; ++i) {
+    reactor r;
+    r.server = this;
+    r.index = i;
+    r.backend = NULL;
+    r.wake_fd = -1;
+    r.spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    r.accepts_shed = 0;
+    r.accepts_failed = 0;
+    r.accept_paused = false;
+    r.accept_resume_ms = 0;
+    r.wait_ms = -1;
+    r.stopping = false;
+    r.timers = TimerWheel(clock_tick_());
+#ifdef SO_REUSEPORT
+    r.listen_fd = open_listener_(INADDR_ANY, port, true);
+#else
+    r.listen_fd =
+        (i == 0) ? open_listener_(INADDR_ANY, port, false)
+                 : reactors_[0].listen_fd;
+#endif
+    reactors_.push_back(r);
+    if ((reactors_.back().wake_fd = eventfd(0, EFD_NONBLOCK)) < 0)
+      throw std::runtime_error("Could not create reactor eventfd");
+  }
+
+  // Scrapes come from the host itself, never from the IRC port's clients
+  if (config_.metrics_port)
+    metrics_fd_ = open_listener_(INADDR_LOOPBACK, config_.metrics_port, false);
+
+  // Update server state
+  running_ = true;
+
+#if DEBUG
+  std::cout << "Server is now listening on port " << port << " with "
+            << config_.workers << " event loop(s)" << std::endl;
+#endif
+}
+
+/**
+ * @brief Every connection is an fd, so the soft RLIMIT_NOFILE (often 1024) is
+ * raised to the hard limit. If that is still too low for max_clients, the
+ * limit is lowered instead of failing accept() later on.
+ */
+void Server::raise_fd_limit_() {
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) < 0) return;
+
+  if (limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) < 0) getrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  // Listeners, event backends, eventfds, spare fds, the metrics export and
+  // stdio
+  size_t reserved = 4 * config_.workers + 10;
+  if (limit.rlim_cur != RLIM_INFINITY &&
+      config_.max_clients + reserved > limit.rlim_cur) {
+    config_.max_clients =
+        limit.rlim_cur > reserved ? limit.rlim_cur - reserved : 1;
+    std::cout << "File descriptor limit allows only " << config_.max_clients
+              << " clients" << std::endl;
+  }
+}
+
+/**
+ * @brief Opens a non-blocking listening socket.
+ *
+ * @param reuse_port whether the socket shares the port with the other
+ * reactors' listeners (SO_REUSEPORT); a listener of its own keeps it, so a
+ * second process can't bind the port and take a share of the connections
+ */
+int Server::open_listener_(in_addr_t address, int port, bool reuse_port) {
+  struct sockaddr_in server_addr;
+  int socket_fd;
 
   // Create a socket
-  if ((socket_fd_ = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+  if ((socket_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
     throw std::runtime_error("Could not open socket");
 
   // Configure the server address structure
   memset(&server_addr, 0, sizeof(server_addr));
   server_addr.sin_family = AF_INET;
-  server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  server_addr.sin_addr.s_addr = htonl(address);
   server_addr.sin_port = htons(port);
 
   // call reuseport in order to free the port immediately after closing
   int reuse = 1;
-  if (setsockopt(socket_fd_, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse,
+  if (setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse,
                  sizeof(reuse)) < 0) {
-    close(socket_fd_);
+    close(socket_fd);
     throw std::runtime_error("Could not set reuseaddr option");
   }
 
 #ifdef SO_REUSEPORT
-  if (setsockopt(socket_fd_, SOL_SOCKET, SO_REUSEPORT, (const char *)&reuse,
+  if (reuse_port &&
+      setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, (const char *)&reuse,
                  sizeof(reuse)) < 0) {
-    close(socket_fd_);
+    close(socket_fd);
     throw std::runtime_error("Could not set reuseport option");
   }
 #endif
 
   // Bind the socket to the specified port
-  if (bind(socket_fd_, (struct sockaddr *)&server_addr, sizeof(server_addr)) <
+  if (bind(socket_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) <
       0) {
-    close(socket_fd_);
+    close(socket_fd);
     throw std::runtime_error("Could not bind socket to port");
   }
 
   // Start listening for incoming connections
-  if (listen(socket_fd_, MAX_CLIENTS) < 0) {
-    close(socket_fd_);
+  if (listen(socket_fd, config_.listen_backlog) < 0) {
+    close(socket_fd);
     throw std::runtime_error("Could not initialize listening on port");
   }
 
-  // Update server state
-  running_ = true;
-
-#if DEBUG
-  std::cout << "Server is now listening on port " << port << std::endl;
-#endif
+  // Several reactors may race for the same connection
+  fcntl(socket_fd, F_SETFL, O_NONBLOCK);
+  return socket_fd;
 }
 
+/**
+ * @brief Formats the message once and queues a reference to it for every
+ * member of the channel.
+ *
+ * @param channel the recipients
+ * @param message the message without the trailing CRLF
+ * @param except_fd a member that doesn't get the message (the sender)
+ * @param priority SEND_LOW for chatter a slow reader may miss
+ */
 void Server::send_message_to_channel_(const Channel &channel,
-                                      const std::string &message) {
-  const std::vector<std::string> &userlist = channel.get_users();
-  for (size_t i = 0; i < userlist.size(); ++i) {
-    queue_.push(std::make_pair(map_name_fd_[userlist[i]], message));
+                                      const std::string &message,
+                                      int except_fd, send_priority priority) {
+  SharedBuffer shared(message);
+  const std::vector<member> &members = channel.get_members();
+  for (size_t i = 0; i < members.size(); ++i) {
+    int fd = ClientTable::fd_of(members[i].id);
+    if (fd != except_fd) queue_message_(fd, shared, priority);
   }
 }
 
@@ -80,44 +199,107 @@ void Server::send_message_to_users_with_shared_channels_(Client &client,
   std::set<int> fd_users;
   const std::vector<std::string> &channellist = client.get_channels_list();
   for (size_t i = 0; i < channellist.size(); ++i) {
-    const std::vector<std::string> &userlist =
-        channels_[channellist[i]].get_users();
-    for (size_t j = 0; j < userlist.size(); ++j)
-      fd_users.insert(map_name_fd_[userlist[j]]);
+    const Channel *channel = channels_.find(channellist[i]);
+    if (!channel) continue;
+    const std::vector<member> &members = channel->get_members();
+    for (size_t j = 0; j < members.size(); ++j)
+      fd_users.insert(ClientTable::fd_of(members[j].id));
   }
 
+  SharedBuffer shared(message);
   std::set<int>::iterator it = fd_users.begin();
   std::set<int>::iterator end = fd_users.end();
   while (it != end) {
-    queue_.push(std::make_pair(*(it++), message));
+    queue_message_(*(it++), shared);
+  }
+}
+
+/**
+ * @brief Drops the cached ban verdicts of a client in all its channels, for
+ * when its nickmask changed.
+ */
+void Server::forget_ban_status_(const Client &client) {
+  const std::vector<std::string> &channellist = client.get_channels_list();
+  for (size_t i = 0; i < channellist.size(); ++i) {
+    Channel *channel = channels_.find(channellist[i]);
+    if (channel) channel->forget_ban_status(client.get_id());
+  }
+}
+
+static size_t command_hash(const char *name, size_t size) {
+  // FNV-1a
+  size_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= (unsigned char)name[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void Server::add_command_(
+    const char *name, void (Server::*handler)(int, std::vector<std::string> &),
+    size_t min_params, bool needs_registration, rate_class cost) {
+  size_t i = command_hash(name, strlen(name)) % COMMAND_TABLE_SIZE;
+  while (commands_[i].name) i = (i + 1) % COMMAND_TABLE_SIZE;
+
+  commands_[i].name = name;
+  commands_[i].handler = handler;
+  commands_[i].min_params = min_params;
+  commands_[i].needs_registration = needs_registration;
+  commands_[i].cost = cost;
+}
+
+/**
+ * @brief Resolves a command name in a single hash lookup. The name is
+ * uppercased while hashing, so it is folded only once per message.
+ *
+ * @param name the command as sent by the client
+ * @return the command's entry or NULL for unknown commands
+ */
+const command_entry *Server::find_command(const slice &name) const {
+  if (!name.size || name.size > COMMAND_NAME_MAX) return NULL;
+
+  char folded[COMMAND_NAME_MAX];
+  for (size_t i = 0; i < name.size; ++i)
+    folded[i] = toupper((unsigned char)name.data[i]);
+
+  size_t i = command_hash(folded, name.size) % COMMAND_TABLE_SIZE;
+  while (commands_[i].name) {
+    if (!strncmp(commands_[i].name, folded, name.size) &&
+        commands_[i].name[name.size] == '\0')
+      return &commands_[i];
+    i = (i + 1) % COMMAND_TABLE_SIZE;
   }
+  return NULL;
 }
 
-void Server::init_function_vector_() {
-  functions_.push_back(std::make_pair("PASS", &Server::pass_));
-  functions_.push_back(std::make_pair("USER", &Server::user_));
-  functions_.push_back(std::make_pair("NICK", &Server::nick_));
-  functions_.push_back(std::make_pair("PONG", &Server::pong_));
-  functions_.push_back(std::make_pair("PING", &Server::ping_));
-  functions_.push_back(std::make_pair("QUIT", &Server::quit_));
-  functions_.push_back(std::make_pair("PRIVMSG", &Server::privmsg_));
-  functions_.push_back(std::make_pair("LUSERS", &Server::lusers_));
-  functions_.push_back(std::make_pair("OPER", &Server::oper_));
-  functions_.push_back(std::make_pair("MODE", &Server::mode_));
-  functions_.push_back(std::make_pair("KILL", &Server::kill_));
-  functions_.push_back(std::make_pair("JOIN", &Server::join_));
-  functions_.push_back(std::make_pair("NOTICE", &Server::notice_));
-  functions_.push_back(std::make_pair("INVITE", &Server::invite_));
-  functions_.push_back(std::make_pair("KICK", &Server::kick_));
-  functions_.push_back(std::make_pair("TOPIC", &Server::topic_));
-  functions_.push_back(std::make_pair("PART", &Server::part_));
-
-  // Functions that are available when you are unauthorized
-  functions_unauthorized_.push_back(std::make_pair("PASS", &Server::pass_));
-  functions_unauthorized_.push_back(std::make_pair("USER", &Server::user_));
-  functions_unauthorized_.push_back(std::make_pair("NICK", &Server::nick_));
-  functions_unauthorized_.push_back(std::make_pair("PONG", &Server::pong_));
-  functions_unauthorized_.push_back(std::make_pair("QUIT", &Server::quit_));
+void Server::init_command_table_() {
+  memset(commands_, 0, sizeof(commands_));
+  for (size_t i = 0; i < COMMAND_TABLE_SIZE; ++i) {
+    command_stats_[i].calls = 0;
+    command_stats_[i].bytes = 0;
+  }
+
+  // Available when you are unauthorized
+  add_command_("PASS", &Server::pass_, 0, false, RATE_LIGHT);
+  add_command_("USER", &Server::user_, 0, false, RATE_LIGHT);
+  add_command_("NICK", &Server::nick_, 0, false, RATE_NORMAL);
+  add_command_("PONG", &Server::pong_, 0, false, RATE_LIGHT);
+  add_command_("QUIT", &Server::quit_, 0, false, RATE_LIGHT);
+
+  add_command_("PING", &Server::ping_, 0, true, RATE_LIGHT);
+  add_command_("PRIVMSG", &Server::privmsg_, 0, true, RATE_NORMAL);
+  add_command_("NOTICE", &Server::notice_, 0, true, RATE_NORMAL);
+  add_command_("LUSERS", &Server::lusers_, 0, true, RATE_HEAVY);
+  add_command_("OPER", &Server::oper_, 2, true, RATE_NORMAL);
+  add_command_("MODE", &Server::mode_, 1, true, RATE_NORMAL);
+  add_command_("KILL", &Server::kill_, 0, true, RATE_NORMAL);
+  add_command_("JOIN", &Server::join_, 1, true, RATE_HEAVY);
+  add_command_("INVITE", &Server::invite_, 2, true, RATE_NORMAL);
+  add_command_("KICK", &Server::kick_, 2, true, RATE_NORMAL);
+  add_command_("TOPIC", &Server::topic_, 1, true, RATE_NORMAL);
+  add_command_("PART", &Server::part_, 1, true, RATE_NORMAL);
+  add_command_("STATS", &Server::stats_, 0, true, RATE_HEAVY);
 
   mode_functions_.insert(std::make_pair('n', &Server::mode_channel_n_));
   mode_functions_.insert(std::make_pair('o', &Server::mode_channel_o_));
@@ -2,17 +2,200 @@
 
 #include "Channel.hpp"
 #include "Client.hpp"
+#include "ClientTable.hpp"
+#include "EventBackend.hpp"
+#include "InputBuffer.hpp"
+#include "Metrics.hpp"
+#include "NameRegistry.hpp"
+#include "ReplyBuilder.hpp"
+#include "Resolver.hpp"
+#include "ServerConfig.hpp"
+#include "TimerWheel.hpp"
+#include "kernels.hpp"
 #include "include.hpp"
 
 namespace irc {
 
+class Server;
+
+#define COMMAND_TABLE_SIZE 64
+#define COMMAND_NAME_MAX 16
+// Numeric replies are three digits
+#define NUMERIC_MAX 1000
+#define MOTD_FILE "ressources/motd.txt"
+// How long the metrics export waits for the request of a scrape
+#define METRICS_REQUEST_TIMEOUT_MS 200
+// At most one stall record per interval, the others are only counted
+#define STALL_LOG_INTERVAL_MS 1000
+// How long a reactor that is out of fds, spare included, stops accepting
+#define ACCEPT_PAUSE_MS 100
+
+// How expensive a command is for the flood control
+enum rate_class { RATE_LIGHT, RATE_NORMAL, RATE_HEAVY };
+// Each started batch of this many recipients of a channel message costs
+// another normal command
+#define FLOOD_FANOUT_STEP 64
+
+// Channel chatter is the first to wait, then to go, for a slow reader
+enum send_priority { SEND_NORMAL, SEND_LOW };
+
+struct command_entry {
+  const char *name;
+  void (Server::*handler)(int, std::vector<std::string> &);
+  // Parameters below which ERR_NEEDMOREPARAMS is sent without calling it
+  size_t min_params;
+  bool needs_registration;
+  rate_class cost;
+};
+
+// Bytes read from one fd, already appended to its input buffer and parsed
+struct pending_read {
+  int fd;
+  bool eof;
+  uint32_t tag;
+  size_t size;
+};
+
+/**
+ * @brief Counts for LUSERS and the metrics, kept up to date on registration,
+ * OPER, MODE -o and disconnect instead of being recounted over all clients.
+ * Connections and channels are the sizes of their tables; connections that
+ * aren't users are the unknown ones.
+ */
+struct server_counters {
+  // Registered clients
+  size_t users;
+  size_t operators;
+  // Most users at the same time since startup
+  size_t peak_users;
+  // Messages to slow readers: deferred past sendq_defer, dropped past
+  // sendq_drop, and clients disconnected past max_sendq
+  size_t sendq_deferred;
+  size_t sendq_dropped;
+  size_t sendq_exceeded;
+  // Connections that became clients, that were turned away (server full, or
+  // closed right away for lack of fds) and accepts that failed otherwise
+  size_t connections_accepted;
+  size_t connections_rejected;
+  size_t accept_errors;
+  // Clients that completed the registration since startup
+  size_t registrations;
+  size_t bytes_received;
+  // Shared messages queued for a recipient (channel and shared-channel
+  // fanout, one per recipient)
+  size_t messages_fanned_out;
+  size_t unknown_commands;
+  // Loop iterations over the stall budget
+  size_t loop_stalls;
+};
+
+// What process_message_ records for one entry of the command table
+struct command_stats {
+  uint64_t calls;
+  // Bytes of the lines, CRLF included
+  uint64_t bytes;
+  Histogram latency;
+};
+
+// Parts of a loop iteration the stall watchdog tells apart
+enum loop_phase {
+  // From the wakeup until the lock is requested: accepting, reading and
+  // cutting lines
+  PHASE_READ,
+  // Waiting for the server lock
+  PHASE_LOCK,
+  // New clients, resolved hostnames and MOTD reloads
+  PHASE_ACCEPT,
+  // Sending the last iteration's output, completed sends and writable
+  // sockets
+  PHASE_SEND,
+  // Staged input and flood control
+  PHASE_PARSE,
+  // Command handlers, in whichever phase they ran
+  PHASE_DISPATCH,
+  // Deferred clients and expired timers
+  PHASE_TIMERS,
+  // Slow consumers, output and closing
+  PHASE_FLUSH,
+  LOOP_PHASES
+};
+
+/**
+ * @brief Where one loop iteration of a reactor spent its time (us), and its
+ * slowest command, for the stall log
+ */
+struct loop_trace {
+  // End of the last phase
+  uint64_t mark;
+  uint64_t phase_us[LOOP_PHASES];
+  // Handler time not yet taken out of the running phase
+  uint64_t dispatch_us;
+  // NULL if no command ran
+  const char *command;
+  uint64_t command_us;
+  client_id client;
+  int fd;
+  std::string channel;
+};
+
+/**
+ * @brief One event loop thread. It owns an event backend, its own
+ * SO_REUSEPORT listener and the connections accepted on it. Accepts, socket
+ * reads, cutting the input into lines and the sendmsg() calls happen without
+ * the server lock; everything touching IRC state (dispatch, fanout, queueing
+ * output, timers) happens under it, so only one reactor at a time does that
+ * part and more reactors do not make command handling itself faster.
+ */
+struct reactor {
+  Server *server;
+  size_t index;
+  EventBackend *backend;
+  int listen_fd;
+  int wake_fd;
+  pthread_t thread;
+  std::vector<std::pair<int, struct sockaddr_in> > accepted;
+  // Kept open to be given up for one accept() when the process is out of
+  // fds, so the connection can be closed instead of filling the backlog
+  int spare_fd;
+  // Accept outcomes of the lock-free phase, added to the counters after it
+  size_t accepts_shed;
+  size_t accepts_failed;
+  // The listener is off until accept_resume_ms (0 until the locked phase
+  // set it), as a connection nobody can accept would be reported endlessly
+  bool accept_paused;
+  uint64_t accept_resume_ms;
+  std::vector<pending_read> reads;
+  // Indexed by fd, only ever touched by the owner
+  std::vector<InputBuffer *> inputs;
+  // Fds that hit the read limit, edge-triggered epoll won't report them again
+  std::vector<int> read_again;
+  std::vector<int> writable;
+  std::vector<io_event> sent;
+  std::vector<io_event> events;
+  // Connections dropped in a locked phase, closed by the owner only, after
+  // its backend's rearm()
+  std::vector<int> pending_close;
+  // Deadlines of the reactor's own connections, armed by it alone
+  TimerWheel timers;
+  // Clients over their rate with lines left, resumed once it refilled
+  std::vector<client_id> deferred;
+  // Clients with lines waiting for their turn, in round-robin order
+  std::vector<client_id> runnable;
+  // Backend wait timeout until the next deadline, -1 for none
+  int wait_ms;
+  // Set once the backend reported the shutdown eventfd
+  bool stopping;
+  loop_trace trace;
+};
+
 class Server {
  public:
   Server();
   ~Server();
 
-  void init(int port, std::string password);
+  void init(int port, std::string password, const ServerConfig &config);
   void run();
+  const command_entry *find_command(const slice &name) const;
 
  private:
   // Not used
@@ -23,23 +206,45 @@ class Server {
   std::string server_name_;
   std::string password_;
   std::string operator_password_;
-  int socket_fd_;
-  std::map<int, Client> clients_;
-  std::map<std::string, Channel, irc_stringmapcomparator<std::string> >
-      channels_;
-  std::map<std::string, int, irc_stringmapcomparator<std::string> >
-      map_name_fd_;
+  ServerConfig config_;
+  std::vector<reactor> reactors_;
+  reactor *current_reactor_;
+  pthread_mutex_t state_lock_;
+  Resolver resolver_;
+  int shutdown_fd_;
+  ClientTable clients_;
+  NameRegistry<Channel> channels_;
+  // The only place nicknames are keys
+  NameRegistry<client_id> map_name_id_;
   bool running_;
-  std::queue<std::pair<int, std::string> > queue_;
-  std::vector<std::pair<std::string,
-                        void (Server::*)(int, std::vector<std::string> &)> >
-      functions_;
-  std::vector<std::pair<std::string,
-                        void (Server::*)(int, std::vector<std::string> &)> >
-      functions_unauthorized_;
-  std::map<int, std::string> error_codes_;
-  std::set<int> open_ping_responses_;
+  std::vector<int> pending_flush_;
+  server_counters counters_;
+  // Indexed like commands_
+  command_stats command_stats_[COMMAND_TABLE_SIZE];
+  // Time a reactor spends per loop iteration on what wait() returned
+  Histogram loop_time_;
+  // Localhost listener of the metrics export, -1 if disabled
+  int metrics_fd_;
+  pthread_t metrics_thread_;
+  // When the last stall record was logged and the stalls since then
+  uint64_t stall_logged_ms_;
+  size_t stalls_suppressed_;
+  // Clients over max_sendq, disconnected at the end of the loop iteration
+  std::vector<client_id> slow_consumers_;
+  // Open addressing on the hash of the uppercased name
+  command_entry commands_[COMMAND_TABLE_SIZE];
+  // Indexed by the numeric, "" for the ones without a text
+  const char *numeric_texts_[NUMERIC_MAX];
+  // Coarse monotonic clock, read once per loop iteration
+  uint64_t clock_ms_;
   std::time_t creation_time_;
+  // Texts of the replies 002 - 005, they are the same for every client
+  std::vector<std::pair<int, std::string> > welcome_burst_;
+  // The MOTD as the texts of its 372 replies, empty if the file is missing
+  std::vector<std::string> motd_lines_;
+  // Modification time (ns) of the loaded MOTD and the tick it was checked
+  uint64_t motd_mtime_;
+  uint64_t motd_checked_;
   std::map<char, std::pair<size_t, std::string> (Server::*)(
                      int, Channel &, bool, std::vector<std::string>::iterator &,
                      std::vector<std::string>::iterator &)>
@@ -51,12 +256,11 @@ class Server {
   void nick_(int fd, std::vector<std::string> &message);
   void pong_(int fd, std::vector<std::string> &message);
   void ping_(int fd, std::vector<std::string> &message);
-  bool nick_has_invalid_char_(std::string nick);
+  bool nick_has_invalid_char_(const std::string &nick) const;
 
   // Server_errors.cpp
-  std::string numeric_reply_(int error_number, int fd_client,
-                             std::string argument);
-  void init_error_codes_();
+  void send_numeric_(int number, int fd, const std::string &argument);
+  void init_numeric_texts_();
 
   // Server_invite.cpp
   void invite_(int fd, std::vector<std::string> &message);
@@ -126,6 +330,7 @@ class Server {
   // Server_oper.cpp
   void oper_(int fd, std::vector<std::string> &message);
   int search_user_list_(const std::string &user) const;
+  client_id nickname_to_id_(const std::string &nickname) const;
 
   // Server_privmsg.cpp
   void privmsg_(int fd, std::vector<std::string> &message);
@@ -144,36 +349,79 @@ class Server {
   void quit_(int fd, std::vector<std::string> &message);
   void part_(int fd, std::vector<std::string> &message);
   void kick_(int fd, std::vector<std::string> &message);
+  void close_link_(int fd, const std::string &reason);
 
   // Server_replies.cpp
   void RPL_CHANNELCMD(const Channel &channel, const Client &client,
                       const std::string &cmd);
-  void RPL_TOPIC(const Channel &channel, const std::string &client_nick,
-                 int fd);
-  void RPL_NOTOPIC(const std::string &client_nick,
-                   const std::string &channel_name, int fd);
-  void RPL_TOPICWHOTIME(const Channel &channel, const std::string &client_nick,
-                        int fd);
-  void RPL_NAMREPLY(const Channel &channel, const std::string &channel_name,
-                    int fd);
-  void RPL_ENDOFNAMES(const std::string &client_nick,
-                      const std::string &channel_name, int fd);
+  void RPL_TOPIC(const Channel &channel, int fd);
+  void RPL_NOTOPIC(const std::string &channel_name, int fd);
+  void RPL_TOPICWHOTIME(const Channel &channel, int fd);
+  void RPL_NAMREPLY(const Channel &channel, int fd);
+  void RPL_ENDOFNAMES(const std::string &channel_name, int fd);
   void RPL_INVITING(const Channel &channel, const Client &client,
                     const std::string &invitee, int fd);
 
   // Server_run.cpp helpers
-  int epoll_fd_;
-  std::map<int, std::string> client_buffers_;
-  void check_open_ping_responses_();
-  void epoll_init_();
-  void create_new_client_connection_(int socket_fd_);
-  void read_from_client_fd_(int client_fd_);
+  message_view message_;
+  std::vector<std::string> message_args_;
+  static void *reactor_main_(void *arg);
+  void reactor_loop_(reactor &r);
+  void process_reactor_events_(reactor &r);
+  void wake_reactor_(const reactor &r);
+  void update_clock_();
+  uint64_t clock_tick_() const;
+  void arm_client_timer_(Client &client, uint64_t deadline);
+  void run_timers_(reactor &r);
+  void client_timer_expired_(client_id id);
+  int next_wait_ms_(const reactor &r) const;
+  void handle_io_event_(reactor &r, const io_event &event);
+  void accept_client_connection_(reactor &r);
+  bool accept_failed_(reactor &r, int error);
+  bool shed_connection_(reactor &r);
+  void resume_accepting_(reactor &r);
+  void create_new_client_connection_(reactor &r, int new_client_fd,
+                                     struct sockaddr_in &client_addr);
+  void reject_client_connection_(int fd, struct sockaddr_in &client_addr,
+                                 const std::string &reason);
+  void read_from_client_fd_(reactor &r, int client_fd);
+  void stage_client_data_(reactor &r, const io_event &event);
+  void apply_resolved_hostnames_();
   void disconnect_client_(int client_fd);
-  void process_message_(int fd, std::vector<std::string> &message);
-  std::vector<std::string> get_next_message_(std::string &buffer);
-  void send_message_(std::pair<int, std::string> message);
+  void close_connection_(reactor &r, int fd);
+  void process_message_(int fd, const message_view &message);
+  void trace_command_(loop_trace &trace, const char *name, client_id sender,
+                      int fd, uint64_t elapsed);
+  std::string stall_record_(const reactor &r);
+  bool process_client_input_(reactor &r, int fd, Client &client,
+                             size_t budget);
+  bool run_client_input_(reactor &r, int fd, Client &client);
+  void run_input_turns_(reactor &r);
+  void resume_deferred_(reactor &r);
+  void charge_flood_(Client &client, rate_class cost, size_t times);
+  bool flood_exceeded_(const Client &client) const;
+  void queue_message_(int fd, const std::string &message);
+  void queue_message_(int fd, const SharedBuffer &message,
+                      send_priority priority = SEND_NORMAL);
+  Client &reply_to_(int fd);
+  void sendq_exceeded_(Client &client);
+  void drop_slow_consumers_();
+  void flush_client_(int fd);
+  void complete_send_(reactor &r, const io_event &event);
+  void write_error_(int fd);
+  void flush_pending_output_();
   void ping_client_(int fd);
 
+  // Server_stats.cpp
+  void stats_(int fd, std::vector<std::string> &message);
+  void stats_commands_(int fd);
+  void stats_uptime_(int fd);
+  void stats_summary_(int fd);
+  static void *metrics_main_(void *arg);
+  void metrics_loop_();
+  void serve_metrics_(int fd);
+  void write_metrics_(std::ostream &out);
+
   // Server_topic.cpp
   void topic_(int fd, std::vector<std::string> &message);
   void topic_send_info_(int fd, const std::string &channelname,
@@ -188,18 +436,31 @@ class Server {
   void lusers_client_op_unknown_(int fd);
   void lusers_channels_(int fd);
   void lusers_me_(int fd);
+  void lusers_local_global_(int fd);
   // MOTD
   void motd_(int fd, std::vector<std::string> &message);
   void motd_start_(int fd);
   void motd_message_(int fd);
   void motd_end_(int fd);
+  void init_welcome_burst_();
+  void load_motd_();
+  void refresh_motd_();
 
   // Server.cpp helpers
   void send_message_to_channel_(const Channel &channel,
-                                const std::string &message);
+                                const std::string &message,
+                                int except_fd = -1,
+                                send_priority priority = SEND_NORMAL);
   void send_message_to_users_with_shared_channels_(Client &client,
                                                    std::string message);
-  void init_function_vector_();
+  void forget_ban_status_(const Client &client);
+  void init_command_table_();
+  void add_command_(const char *name,
+                    void (Server::*handler)(int, std::vector<std::string> &),
+                    size_t min_params, bool needs_registration,
+                    rate_class cost);
+  void raise_fd_limit_();
+  int open_listener_(in_addr_t address, int port, bool reuse_port);
 };
 
 }  // namespace irc
@@ -0,0 +1,110 @@
+#include "ServerConfig.hpp"
+
+namespace irc {
+
+ServerConfig::ServerConfig()
+    : workers(1), event_backend(BACKEND_EPOLL), max_clients(100000),
+      listen_backlog(SOMAXCONN), epoll_batch(256), read_limit(16384),
+      max_line_length(512),
+      resolver_threads(2), dns_cache_ttl(300), registration_timeout(60),
+      ping_interval(120), ping_timeout(60), flood_interval(250),
+      flood_burst(20), messages_per_tick(16), max_input_buffer(32768),
+      sendq_defer(65536), sendq_drop(262144), max_sendq(1048576),
+      metrics_port(0), stall_budget(500) {}
+
+static bool parse_size_option(const std::string &value, size_t min, size_t max,
+                              size_t &out) {
+  if (value.empty() || value.size() > 9) return false;
+  for (size_t i = 0; i < value.size(); ++i) {
+    if (!isdigit(value.at(i))) return false;
+  }
+  size_t parsed = std::atoi(value.c_str());
+  if (parsed < min || parsed > max) return false;
+  out = parsed;
+  return true;
+}
+
+/**
+ * @brief Applies one "--name=value" argument to the configuration
+ *
+ * @param arg the argument as given on the command line
+ * @param config the configuration to update
+ * @return false if the option is unknown or its value is out of range
+ */
+bool parse_config_option(const std::string &arg, ServerConfig &config) {
+  size_t pos_eq = arg.find('=');
+  if (arg.compare(0, 2, "--") != 0 || pos_eq == std::string::npos)
+    return false;
+
+  std::string name = arg.substr(2, pos_eq - 2);
+  std::string value = arg.substr(pos_eq + 1);
+
+  if (name == "workers") return parse_size_option(value, 1, 64, config.workers);
+  if (name == "event-backend") {
+    if (value == "epoll")
+      config.event_backend = BACKEND_EPOLL;
+    else if (value == "io_uring")
+      config.event_backend = BACKEND_URING;
+    else
+      return false;
+    return true;
+  }
+  if (name == "max-clients")
+    return parse_size_option(value, 1, 1000000, config.max_clients);
+  if (name == "listen-backlog")
+    return parse_size_option(value, 1, 65535, config.listen_backlog);
+  if (name == "epoll-batch")
+    return parse_size_option(value, 1, 65536, config.epoll_batch);
+  if (name == "read-limit")
+    return parse_size_option(value, 512, 16777216, config.read_limit);
+  if (name == "max-line-length")
+    return parse_size_option(value, 512, 65536, config.max_line_length);
+  if (name == "resolver-threads")
+    return parse_size_option(value, 0, 64, config.resolver_threads);
+  if (name == "dns-cache-ttl")
+    return parse_size_option(value, 0, 86400, config.dns_cache_ttl);
+  if (name == "registration-timeout")
+    return parse_size_option(value, 1, 3600, config.registration_timeout);
+  if (name == "ping-interval")
+    return parse_size_option(value, 1, 86400, config.ping_interval);
+  if (name == "ping-timeout")
+    return parse_size_option(value, 1, 3600, config.ping_timeout);
+  if (name == "flood-interval")
+    return parse_size_option(value, 0, 60000, config.flood_interval);
+  if (name == "flood-burst")
+    return parse_size_option(value, 1, 10000, config.flood_burst);
+  if (name == "messages-per-tick")
+    return parse_size_option(value, 1, 100000, config.messages_per_tick);
+  if (name == "max-input-buffer")
+    return parse_size_option(value, 512, 16777216, config.max_input_buffer);
+  if (name == "sendq-defer")
+    return parse_size_option(value, 512, 268435456, config.sendq_defer);
+  if (name == "sendq-drop")
+    return parse_size_option(value, 512, 268435456, config.sendq_drop);
+  if (name == "max-sendq")
+    return parse_size_option(value, 512, 268435456, config.max_sendq);
+  if (name == "metrics-port")
+    return parse_size_option(value, 0, 65535, config.metrics_port);
+  if (name == "stall-budget")
+    return parse_size_option(value, 0, 60000, config.stall_budget);
+  return false;
+}
+
+/**
+ * @brief Checks the options that depend on each other, once all are parsed.
+ * A slow reader's chatter is deferred, then dropped, then the client is;
+ * in any other order a limit would never be reached. The input buffer must
+ * hold at least one line of the longest allowed length.
+ *
+ * @return what is wrong, empty if nothing is
+ */
+std::string check_config(const ServerConfig &config) {
+  if (config.sendq_defer > config.sendq_drop ||
+      config.sendq_drop > config.max_sendq)
+    return "sendq-defer <= sendq-drop <= max-sendq is required";
+  if (config.max_input_buffer < config.max_line_length)
+    return "max-line-length <= max-input-buffer is required";
+  return "";
+}
+
+}  // namespace irc
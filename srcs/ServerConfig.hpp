@@ -0,0 +1,69 @@
+#pragma once
+
+#include "include.hpp"
+
+namespace irc {
+
+// How the reactors do their socket I/O
+enum event_backend_kind { BACKEND_EPOLL, BACKEND_URING };
+
+/**
+ * @brief Runtime tunables. Every field has a default, so the mandatory
+ * command line (port and password) still starts a working server; extra
+ * arguments of the form --name=value override single fields.
+ */
+struct ServerConfig {
+  ServerConfig();
+
+  // Number of event loop threads, each with its own event backend. They
+  // accept, read, parse and send in parallel; commands, fanout, output
+  // queueing and timers still run one reactor at a time under the server lock
+  size_t workers;
+  // epoll (readiness) or io_uring (completions), the same for all reactors
+  event_backend_kind event_backend;
+  // Connections accepted at the same time, further ones get an ERROR
+  size_t max_clients;
+  // Pending connections the kernel queues per listener
+  size_t listen_backlog;
+  // Events fetched per epoll_wait call
+  size_t epoll_batch;
+  // Bytes read from one connection per wakeup before other fds get a turn
+  size_t read_limit;
+  // Longest line a client may send (CRLF included)
+  size_t max_line_length;
+  // Threads doing reverse DNS of new clients, 0 keeps the IP as hostname
+  size_t resolver_threads;
+  // Seconds a reverse DNS result is reused, 0 disables the cache
+  size_t dns_cache_ttl;
+  // Seconds a new connection has to complete the registration
+  size_t registration_timeout;
+  // Seconds of silence from a registered client before it is sent a PING
+  size_t ping_interval;
+  // Seconds a client has to answer a PING
+  size_t ping_timeout;
+  // Milliseconds one normal command costs in the flood control, 0 disables it
+  size_t flood_interval;
+  // Normal commands a client may send at once before its lines are deferred
+  size_t flood_burst;
+  // Lines of one client executed per loop iteration before the others get a
+  // turn
+  size_t messages_per_tick;
+  // Bytes of unprocessed input a client may have before it is dropped
+  size_t max_input_buffer;
+  // Queued output (bytes) beyond which channel chatter to a client is
+  // deferred behind its other messages, then dropped
+  size_t sendq_defer;
+  size_t sendq_drop;
+  // Queued output (bytes) that gets a client disconnected
+  size_t max_sendq;
+  // Localhost port of the Prometheus metrics export, 0 disables it
+  size_t metrics_port;
+  // Milliseconds a loop iteration may take before it is logged as a stall,
+  // 0 disables the log
+  size_t stall_budget;
+};
+
+bool parse_config_option(const std::string &arg, ServerConfig &config);
+std::string check_config(const ServerConfig &config);
+
+}  // namespace irc
@@ -16,12 +16,12 @@ void Server::pass_(int fd, std::vector<std::string> &message) {
   Client &client = clients_[fd];
   if (client.get_status(PASS_AUTH) == true) {
     // Error 462: You may not reregister
-    queue_.push(std::make_pair(fd, numeric_reply_(462, fd, "")));
+    send_numeric_(462, fd, "");
     return;
   }
   if (message.size() == 1) {
     // Error 461: Not enough parameters
-    queue_.push(std::make_pair(fd, numeric_reply_(461, fd, "PASS")));
+    send_numeric_(461, fd, "PASS");
     return;
   }
   if (message.size() == 2 && message[1] == password_) {
@@ -32,7 +32,7 @@ void Server::pass_(int fd, std::vector<std::string> &message) {
     if (client.is_authorized()) welcome_(fd);
   } else {
     // Error 464: password incorrect
-    queue_.push(std::make_pair(fd, numeric_reply_(464, fd, "")));
+    send_numeric_(464, fd, "");
   }
 }
 
@@ -56,12 +56,12 @@ void Server::user_(int fd, std::vector<std::string> &message) {
   }
   if (client.get_status(USER_AUTH)) {
     // Error 462: You may not reregister
-    queue_.push(std::make_pair(fd, numeric_reply_(462, fd, "")));
+    send_numeric_(462, fd, "");
     return;
   }
   if (message.size() < 5) {
     // Error 461: Not enough parameters
-    queue_.push(std::make_pair(fd, numeric_reply_(461, fd, "USER")));
+    send_numeric_(461, fd, "USER");
     return;
   }
   //: server 468 nick :Your username is invalid.
@@ -89,18 +89,17 @@ void Server::nick_(int fd, std::vector<std::string> &message) {
   }
   if (message.size() == 1) {
     // Error 461: Not enough parameters
-    queue_.push(std::make_pair(fd, numeric_reply_(461, fd, "NICK")));
+    send_numeric_(461, fd, "NICK");
     return;
   }
   if (message[1].size() > 9 || nick_has_invalid_char_(message[1])) {
     // 432 erroneous nickname
-    queue_.push(std::make_pair(fd, numeric_reply_(432, fd, message[1])));
+    send_numeric_(432, fd, message[1]);
     return;
   }
-  if (map_name_fd_.count(message[1])) {
+  if (map_name_id_.count(message[1])) {
     // Error 433: Nickname is already in use
-    queue_.push(
-        std::make_pair(fd, numeric_reply_(433, fd, client.get_nickname())));
+    send_numeric_(433, fd, client.get_nickname());
     return;
   }
 
@@ -112,32 +111,27 @@ void Server::nick_(int fd, std::vector<std::string> &message) {
     nickmessage << ":" << client.get_nickmask() << " NICK " << message[1];
     send_message_to_users_with_shared_channels_(client, nickmessage.str());
 
-    // Change nickname in all channels
-    const std::vector<std::string> &channellist = client.get_channels_list();
-    for (size_t i = 0; i < channellist.size(); ++i) {
-      channels_[channellist[i]].change_nickname(old_nickname, message[1]);
-    }
-
     // Erase old nickname from data structures
-    map_name_fd_.erase(old_nickname);
+    map_name_id_.erase(old_nickname);
   }
 
   // Set new nickname
   client.set_nickname(message[1]);
-  map_name_fd_.insert(std::make_pair(message[1], fd));
+  client.set_reply_prefix(server_name_);
+  map_name_id_.insert(message[1], client.get_id());
+  forget_ban_status_(client);
   if (!client.get_status(NICK_AUTH)) {
     client.set_status(NICK_AUTH);
     if (client.is_authorized()) welcome_(fd);
   }
 }
 
-bool Server::nick_has_invalid_char_(std::string nick) {
+bool Server::nick_has_invalid_char_(const std::string &nick) const {
   if (nick.size() < 1) return 1;
   if (nick.at(0) == '#' || nick.at(0) == '&' || nick.at(0) == '@') return 1;
-  for (size_t i = 0; i < nick.size(); ++i) {
-    if (nick.at(i) == ',' || !isprint(nick.at(i))) return 1;
-  }
-  return 0;
+  const char *end = nick.data() + nick.size();
+  return kernels.find_unprintable(nick.data(), end) != end ||
+         kernels.find_any_of(nick.data(), end, ",") != end;
 }
 
 /**
@@ -165,13 +159,13 @@ void Server::ping_(int fd, std::vector<std::string> &message) {
   std::stringstream answer;
   answer << ":" << server_name_ << " PONG";
   if (message.size() < 2) {
-    queue_.push(std::make_pair(fd, answer.str()));
+    queue_message_(fd, answer.str());
 #if DEBUG
     std::cout << "Answered client's PING with: " << answer.str() << std::endl;
 #endif
   } else {
     answer << " " << server_name_ << " " << message[1];
-    queue_.push(std::make_pair(fd, answer.str()));
+    queue_message_(fd, answer.str());
 #if DEBUG
     std::cout << "Answered client's PING with: " << answer.str() << std::endl;
 #endif
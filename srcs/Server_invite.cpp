@@ -9,47 +9,45 @@ void Server::invite_(int fd, std::vector<std::string> &message) {
   Client &client = clients_[fd];
   if (message.size() < 3) {
     // Error 461: Not enough parameters
-    queue_.push(std::make_pair(fd, numeric_reply_(461, fd, "INVITE")));
+    send_numeric_(461, fd, "INVITE");
     return;
   }
   std::string invited_name = message[1];
   std::string channel_name = message[2];
-  if (!map_name_fd_.count(invited_name)) {
+  client_id invited_id = nickname_to_id_(invited_name);
+  if (!invited_id) {
     // 401 no such nickname
-    queue_.push(std::make_pair(fd, numeric_reply_(401, fd, channel_name)));
+    send_numeric_(401, fd, channel_name);
     return;
   }
-  std::map<std::string, Channel,
-           irc_stringmapcomparator<std::string> >::iterator it =
-      channels_.find(channel_name);
-  if (it == channels_.end()) {
+  Channel *found = channels_.find(channel_name);
+  if (!found) {
     // 403 no such channel
-    queue_.push(std::make_pair(fd, numeric_reply_(403, fd, channel_name)));
+    send_numeric_(403, fd, channel_name);
     return;
   }
-  Channel &channel = it->second;
+  Channel &channel = *found;
 
-  if (channel.is_user(invited_name)) {
+  if (channel.is_user(invited_id)) {
     // 443 is already on channel
-    queue_.push(std::make_pair(
-        fd, numeric_reply_(443, fd, invited_name + " " + channel_name)));
+    send_numeric_(443, fd, invited_name + " " + channel_name);
     return;
   }
   // if channel is mode + i(invite only), the client sending the invite must be
   // a channel operator
   if (channel.checkflag(C_INVITE) &&
-      !channel.is_operator(client.get_nickname())) {
+      !channel.is_operator(client.get_id())) {
     // 482 <channel> You're not channel operator
-    queue_.push(std::make_pair(fd, numeric_reply_(482, fd, "")));
+    send_numeric_(482, fd, "");
     return;
   }
   // add the invitee to the invited list of the channel
-  channel.add_invited_user(invited_name);
+  channel.add_invited_user(invited_id);
   RPL_INVITING(channel, client, invited_name, fd);
   std::stringstream servermessage;
   servermessage << client.get_nickmask() << " INVITE " << invited_name << " "
                 << channel_name;
-  queue_.push(std::make_pair(map_name_fd_[invited_name], servermessage.str()));
+  queue_message_(ClientTable::fd_of(invited_id), servermessage.str());
 }
 
 }  // namespace irc
\ No newline at end of file
@@ -7,8 +7,7 @@ void Server::mode_user_(int fd, std::vector<std::string> &message) {
   std::string nick = client.get_nickname();
   if (message.size() == 2) {
     // 221 answer a query about clients's own modes
-    queue_.push(
-        std::make_pair(fd, numeric_reply_(221, fd, client.get_usermodes())));
+    send_numeric_(221, fd, client.get_usermodes());
     return;
   }
   // only the server operator can change modes, otherwise command silently
@@ -22,7 +21,7 @@ void Server::mode_user_(int fd, std::vector<std::string> &message) {
   std::string flags = message[2];
   if (message.size() > 3) {
     // 421 unknown command
-    queue_.push(std::make_pair(fd, numeric_reply_(421, fd, message[3])));
+    send_numeric_(421, fd, message[3]);
   }
   bool sign = true;
   bool badflag = false;
@@ -41,6 +40,7 @@ void Server::mode_user_(int fd, std::vector<std::string> &message) {
     // handle -o
     else if (current == 'o' && !sign && client.get_server_operator_status()) {
       client.set_server_operator_status(0);
+      --counters_.operators;
       removedflags.push_back('o');
     }
     // ignore +o
@@ -66,7 +66,7 @@ void Server::mode_user_(int fd, std::vector<std::string> &message) {
   }
   if (badflag) {
     // 501 err_ unknown mode flag
-    queue_.push(std::make_pair(fd, numeric_reply_(501, fd, "")));
+    send_numeric_(501, fd, "");
   }
   if (addedflags.empty() && removedflags.empty()) {
     return;
@@ -85,7 +85,7 @@ void Server::mode_user_(int fd, std::vector<std::string> &message) {
       flags_changed += addedflags.at(i);
     }
   }
-  queue_.push(std::make_pair(fd, flags_changed));
+  queue_message_(fd, flags_changed);
 }
 
 void Server::mode_(int fd, std::vector<std::string> &message) {
@@ -93,34 +93,34 @@ void Server::mode_(int fd, std::vector<std::string> &message) {
   // this error is wrong
   if (message.size() < 2) {
     // Error 461: Not enough parameters
-    queue_.push(std::make_pair(fd, numeric_reply_(461, fd, "MODE")));
+    send_numeric_(461, fd, "MODE");
     return;
   }
   if (message[1].at(0) == '#') {
     // is channel mode
-    if (!channels_.count(message[1])) {
+    Channel *channel = channels_.find(message[1]);
+    if (!channel) {
       // 401 no such channel
-      queue_.push(std::make_pair(fd, numeric_reply_(403, fd, message[1])));
+      send_numeric_(403, fd, message[1]);
       return;
     } else {
       if (message.size() < 3) {
-        mode_print_flags_(fd, channels_[message[1]]);
+        mode_print_flags_(fd, *channel);
         return;
       }
     }
-    Channel &channel = channels_[message[1]];
-    mode_channel_(fd, message, channel);
+    mode_channel_(fd, message, *channel);
   } else {
     // is user mode
     std::string nick = client.get_nickname();
     if (!irc_stringissame(nick, message[1])) {
-      if (!map_name_fd_.count(message[1])) {
+      if (!map_name_id_.count(message[1])) {
         // 401 no such nickname
-        queue_.push(std::make_pair(fd, numeric_reply_(401, fd, message[1])));
+        send_numeric_(401, fd, message[1]);
         return;
       } else {
         // 502 can't change mode for other users
-        queue_.push(std::make_pair(fd, numeric_reply_(502, fd, "")));
+        send_numeric_(502, fd, "");
         return;
       }
     }
@@ -130,8 +130,7 @@ void Server::mode_(int fd, std::vector<std::string> &message) {
 
 void Server::mode_channel_(int fd, std::vector<std::string> &message,
                            Channel &channel) {
-  Client &client = clients_[fd];
-  if (!channel.get_operators().count(client.get_nickname())) {
+  if (!channel.is_operator(clients_[fd].get_id())) {
     // check only for +b without arg flag
     check_plus_b_no_arg_flag_(fd, message, channel);
     return;
@@ -173,8 +172,7 @@ void Server::mode_channel_(int fd, std::vector<std::string> &message,
       }
     } else {
       // Error 472: is unknown mode char to me
-      queue_.push(
-          std::make_pair(fd, numeric_reply_(472, fd, std::string(1, current))));
+      send_numeric_(472, fd, std::string(1, current));
     }
   }
   // If one or more commands were successful, send an info message to the
@@ -250,25 +248,26 @@ std::pair<size_t, std::string> Server::mode_channel_o_(
   }
 
   std::string &name = *(arg++);
-  if (!channel.is_user(name)) {
+  client_id member_id = nickname_to_id_(name);
+  if (!channel.is_user(member_id)) {
     // Error 401: No such nick
-    queue_.push(std::make_pair(fd, numeric_reply_(401, fd, name)));
+    send_numeric_(401, fd, name);
     return std::make_pair(0, "");
   }
 
   // +o
   if (plus) {
-    if (channel.is_operator(name)) {
+    if (channel.is_operator(member_id)) {
       // ignore silently
       return std::make_pair(0, "");
     }
-    channel.add_operator(name);
+    channel.add_operator(member_id);
     return std::make_pair(1, name);
   }
   // -o
   else {
-    if (channel.is_operator(name)) {
-      channel.remove_operator(name);
+    if (channel.is_operator(member_id)) {
+      channel.remove_operator(member_id);
       return std::make_pair(1, name);
     }
     // ignore silently
@@ -355,7 +354,7 @@ std::pair<size_t, std::string> Server::mode_channel_l_(
   else {
     if (arg == end) {
       // 461 not enough parameters
-      queue_.push(std::make_pair(fd, numeric_reply_(461, fd, channel.get_channelname())));
+      send_numeric_(461, fd, channel.get_channelname());
       return std::make_pair(0, std::string());
     }
     std::string tmp_arg = (*arg);
@@ -412,7 +411,7 @@ void Server::mode_channel_b_list_(int fd, const Channel &channel) {
     servermessage << prefix << current.banned_nickname << "!"
                   << current.banned_username << "@" << current.banned_hostname
                   << " " << current.banned_by << " " << current.time_of_ban;
-    queue_.push(std::make_pair(fd, servermessage.str()));
+    queue_message_(fd, servermessage.str());
   }
 
   // End with RPL_ENDBANLIST (368)
@@ -420,7 +419,7 @@ void Server::mode_channel_b_list_(int fd, const Channel &channel) {
   servermessage << ":" << server_name_ << " 368 " << clients_[fd].get_nickname()
                 << " " << channel.get_channelname()
                 << " :End of Channel Ban List";
-  queue_.push(std::make_pair(fd, servermessage.str()));
+  queue_message_(fd, servermessage.str());
 }
 
 std::pair<size_t, std::string> Server::mode_channel_b_add_banmask_(
@@ -431,17 +430,8 @@ std::pair<size_t, std::string> Server::mode_channel_b_add_banmask_(
   parse_banmask(*arg++, banmask_nickname, banmask_username, banmask_hostname);
 
   // Is the banmask already covered by the existing masks?
-  const std::vector<banmask> &list_banmasks = channel.get_banned_users();
-  for (size_t i = 0; i < list_banmasks.size(); ++i) {
-    const banmask &current = list_banmasks[i];
-    if (irc_wildcard_cmp(banmask_nickname.c_str(),
-                         current.banned_nickname.c_str()) &&
-        irc_wildcard_cmp(banmask_username.c_str(),
-                         current.banned_username.c_str()) &&
-        irc_wildcard_cmp(banmask_hostname.c_str(),
-                         current.banned_hostname.c_str()))
-      return std::make_pair(0, "");
-  }
+  if (channel.is_banned(banmask_nickname, banmask_username, banmask_hostname))
+    return std::make_pair(0, "");
   channel.remove_banmask(banmask_nickname + "!" + banmask_username + "@" + banmask_hostname);
   channel.add_banmask(banmask_nickname, banmask_username, banmask_hostname,
                       clients_[fd].get_nickname());
@@ -457,20 +447,21 @@ std::pair<size_t, std::string> Server::mode_channel_v_(
     std::vector<std::string>::iterator &end) {
   if (arg == end) {
     // Error 461: Not enough parameters
-    queue_.push(std::make_pair(fd, numeric_reply_(461, fd, "MODE +/-v")));
+    send_numeric_(461, fd, "MODE +/-v");
     return std::make_pair(0, "");
   }
   std::string nickname = (*arg);
   arg++;
+  client_id member_id = nickname_to_id_(nickname);
   // if the nickname is not valid
-  if (!channel.is_user(nickname)) {
-    queue_.push(std::make_pair(fd, numeric_reply_(401, fd, nickname)));
+  if (!channel.is_user(member_id)) {
+    send_numeric_(401, fd, nickname);
     return std::make_pair(0, std::string());
   }
   // if the user is not on the speaker list
-  if (!channel.get_speakers().count(nickname)) {
+  if (!channel.is_speaker(member_id)) {
     if (plus) {
-      channel.add_speaker(nickname);
+      channel.add_speaker(member_id);
       return std::make_pair(1, nickname);
     } else {
       return std::make_pair(0, std::string());
@@ -479,7 +470,7 @@ std::pair<size_t, std::string> Server::mode_channel_v_(
   // if the user is on the speaker list
   else {
     if (!plus) {
-      channel.remove_speaker(nickname);
+      channel.remove_speaker(member_id);
       return std::make_pair(1, nickname);
     } else {
       return std::make_pair(0, std::string());
@@ -494,7 +485,7 @@ std::pair<size_t, std::string> Server::mode_channel_k_(
     std::vector<std::string>::iterator &end) {
   if (arg == end) {
     // Error 461: Not enough parameters
-    queue_.push(std::make_pair(fd, numeric_reply_(461, fd, channel.get_channelname())));
+    send_numeric_(461, fd, channel.get_channelname());
     return std::make_pair(0, "");
   }
   std::string &key = *(arg++);
@@ -503,14 +494,12 @@ std::pair<size_t, std::string> Server::mode_channel_k_(
     // If password is already set, give an error
     if (!channel.get_channel_password().empty()) {
       // Error 467: Channel key already set
-      queue_.push(std::make_pair(
-          fd, numeric_reply_(467, fd, channel.get_channelname())));
+      send_numeric_(467, fd, channel.get_channelname());
       return std::make_pair(0, "");
     }
     if (!channel_key_is_valid(key)) {
       // Error 525: Key is not well-formed
-      queue_.push(std::make_pair(
-          fd, numeric_reply_(525, fd, channel.get_channelname())));
+      send_numeric_(525, fd, channel.get_channelname());
       return std::make_pair(0, "");
     }
     channel.set_channel_password(key);
@@ -521,8 +510,7 @@ std::pair<size_t, std::string> Server::mode_channel_k_(
     if (key != channel.get_channel_password()) {
 /*       // Error 467: Channel key already set <- strange error, but quakenet sends
       // this
-      queue_.push(std::make_pair(
-          fd, numeric_reply_(467, fd, channel.get_channelname()))); */
+      send_numeric_(467, fd, channel.get_channelname()); */
       return std::make_pair(0, "");
     }
     std::string emptypw;
@@ -560,14 +548,12 @@ void Server::check_plus_b_no_arg_flag_(int fd,
       }
     } else {
       // Error 472: is unknown mode char to me
-      queue_.push(
-          std::make_pair(fd, numeric_reply_(472, fd, std::string(1, current))));
+      send_numeric_(472, fd, std::string(1, current));
     }
   }
   if (not_operator_msg) {
     // 482 You're not channel operator
-    queue_.push(
-        std::make_pair(fd, numeric_reply_(482, fd, channel.get_channelname())));
+    send_numeric_(482, fd, channel.get_channelname());
   }
 }
 
@@ -607,10 +593,10 @@ void Server::mode_print_flags_(int fd, Channel &channel) {
   if (!string_args.empty()) {
     output << " " << string_args.at(0);
   }
-  queue_.push(std::make_pair(fd, numeric_reply_(324, fd, output.str())));
+  send_numeric_(324, fd, output.str());
   std::stringstream argument;
   argument << channel.get_channelname() << " " << channel.get_creationtime();
-  queue_.push(std::make_pair(fd, numeric_reply_(329, fd, argument.str())));
+  send_numeric_(329, fd, argument.str());
 }
 
 }  // namespace irc
\ No newline at end of file
@@ -5,17 +5,16 @@ namespace irc {
 void Server::oper_(int fd, std::vector<std::string> &message) {
   if (message.size() < 3) {
     // Error 461: Not enough parameters
-    queue_.push(std::make_pair(fd, numeric_reply_(461, fd, "OPER")));
+    send_numeric_(461, fd, "OPER");
     return;
   }
-  std::string username = message[1];
-  if (!map_name_fd_.count(username)) {
-    queue_.push(
-        // 444 User not logged in (cant find username)
-        std::make_pair(fd, numeric_reply_(444, fd, message[1])));
+  client_id user_id = nickname_to_id_(message[1]);
+  if (!user_id) {
+    // 444 User not logged in (cant find username)
+    send_numeric_(444, fd, message[1]);
     return;
   }
-  int user_fd = map_name_fd_[username];
+  int user_fd = ClientTable::fd_of(user_id);
   if (clients_[user_fd].get_server_operator_status() == 1) {
     // that user is already an operator
     return;
@@ -23,18 +22,30 @@ void Server::oper_(int fd, std::vector<std::string> &message) {
   if (message[2] == operator_password_) {
     // 381 You are now an IRC operator
     clients_[user_fd].set_server_operator_status(1);
-    queue_.push(std::make_pair(fd, numeric_reply_(381, fd, "")));
+    ++counters_.operators;
+    send_numeric_(381, fd, "");
   } else {
     // 464 password incorrect
-    queue_.push(std::make_pair(fd, numeric_reply_(464, fd, "")));
+    send_numeric_(464, fd, "");
   }
 }
 
+/**
+ * @brief Finds a connected client by nickname without inserting anything.
+ *
+ * @param nickname the nickname, compared case-insensitively
+ * @return the client's id or 0
+ */
+client_id Server::nickname_to_id_(const std::string &nickname) const {
+  const client_id *id = map_name_id_.find(nickname);
+  return id ? *id : 0;
+}
+
 int Server::search_user_list_(const std::string &user) const {
-  std::map<int, Client>::const_iterator it;
-  for (it = clients_.begin(); it != clients_.end(); ++it) {
-    if (irc_stringissame(user, (*it).second.get_username())) {
-      return (*it).first;
+  const std::vector<int> &fds = clients_.fds();
+  for (size_t i = 0; i < fds.size(); ++i) {
+    if (irc_stringissame(user, clients_.find(fds[i])->get_username())) {
+      return fds[i];
     }
   }
   return -1;
@@ -12,16 +12,19 @@ namespace irc {
 void Server::privmsg_(int fd, std::vector<std::string> &message) {
   if (message.size() == 1) {
     // Error 411: No recipient given
-    queue_.push(std::make_pair(fd, numeric_reply_(411, fd, "PRIVMSG")));
+    send_numeric_(411, fd, "PRIVMSG");
     return;
   } else if (message.size() == 2) {
     // Error 412: No text to send
-    queue_.push(std::make_pair(fd, numeric_reply_(412, fd, "")));
+    send_numeric_(412, fd, "");
     return;
   }
 
   std::vector<std::string> recipients = split_string(message[1], ',');
 
+  // Every further recipient counts as another message
+  if (recipients.size() > 1)
+    charge_flood_(clients_[fd], RATE_NORMAL, recipients.size() - 1);
   for (size_t i = 0; i < recipients.size(); ++i) {
     // Recipient is channel (starts with '#' or '&')
     if (recipients[i].size() &&
@@ -38,56 +41,48 @@ void Server::privmsg_(int fd, std::vector<std::string> &message) {
 void Server::privmsg_to_channel_(int fd_sender, std::string channelname,
                                  std::string message) {
   // Channel not found
-  if (channels_.find(channelname) == channels_.end()) {
+  Channel *found = channels_.find(channelname);
+  if (!found) {
     // Error 403: No such channel
-    queue_.push(
-        std::make_pair(fd_sender, numeric_reply_(403, fd_sender, channelname)));
+    send_numeric_(403, fd_sender, channelname);
     return;
   }
-  Channel &channel = channels_[channelname];
+  Channel &channel = *found;
   const Client &client = clients_[fd_sender];
-  const std::string &clientname = client.get_nickname();
+  client_id sender = client.get_id();
 
   // If +n flag is set and user is not in the channel or
   // if +m flag is set and user is not an operator (+o) or speaker (+v)
-  if ((channel.checkflag(C_OUTSIDE) && !channel.is_user(clientname)) ||
-      (channel.checkflag(C_MODERATED) && !channel.is_operator(clientname) &&
-       !channel.is_speaker(clientname)) ||
-      channel.is_banned(clientname, client.get_username(),
-                        client.get_hostname())) { // if user is banned
+  if ((channel.checkflag(C_OUTSIDE) && !channel.is_user(sender)) ||
+      (channel.checkflag(C_MODERATED) && !channel.is_operator(sender) &&
+       !channel.is_speaker(sender)) ||
+      channel.is_banned(client)) { // if user is banned
     // Error 404: Cannot send to channel
-    queue_.push(
-        std::make_pair(fd_sender, numeric_reply_(404, fd_sender, channelname)));
+    send_numeric_(404, fd_sender, channelname);
     return;
   }
 
-  const std::vector<std::string> &userlist = channel.get_users();
-
-  for (size_t i = 0; i < userlist.size(); ++i) {
-    std::stringstream servermessage;
-    std::string username = userlist[i];
-    std::string sendername = clients_[fd_sender].get_nickname();
-    if (sendername != username) {
-      servermessage << ":" << client.get_nickmask() << " PRIVMSG "
-                    << channelname << " :" << message;
-      queue_.push(std::make_pair(map_name_fd_[username], servermessage.str()));
-    }
-  }
+  std::stringstream servermessage;
+  servermessage << ":" << client.get_nickmask() << " PRIVMSG " << channelname
+                << " :" << message;
+  send_message_to_channel_(channel, servermessage.str(), fd_sender, SEND_LOW);
+  charge_flood_(clients_[fd_sender], RATE_NORMAL,
+                (channel.get_members().size() - 1) / FLOOD_FANOUT_STEP);
 }
 
 void Server::privmsg_to_user_(int fd_sender, std::string nickname,
                               std::string message) {
-  if (map_name_fd_.find(nickname) == map_name_fd_.end()) {
+  client_id recipient = nickname_to_id_(nickname);
+  if (!recipient) {
     // Error 401: No such nick
-    queue_.push(
-        std::make_pair(fd_sender, numeric_reply_(401, fd_sender, nickname)));
+    send_numeric_(401, fd_sender, nickname);
     return;
   }
 
   std::stringstream servermessage;
   servermessage << ":" << clients_[fd_sender].get_nickmask() << " PRIVMSG "
                 << nickname << " :" << message;
-  queue_.push(std::make_pair(map_name_fd_[nickname], servermessage.str()));
+  queue_message_(ClientTable::fd_of(recipient), servermessage.str());
 }
 
 /**
@@ -103,6 +98,9 @@ void Server::notice_(int fd, std::vector<std::string> &message) {
 
   std::vector<std::string> recipients = split_string(message[1], ',');
 
+  // Every further recipient counts as another message
+  if (recipients.size() > 1)
+    charge_flood_(clients_[fd], RATE_NORMAL, recipients.size() - 1);
   for (size_t i = 0; i < recipients.size(); ++i) {
     // Recipient is channel (starts with '#' or '&')
     if (recipients[i].size() &&
@@ -119,46 +117,40 @@ void Server::notice_(int fd, std::vector<std::string> &message) {
 void Server::notice_to_channel_(int fd_sender, std::string channelname,
                                 std::string message) {
   // Channel not found
-  if (channels_.find(channelname) == channels_.end()) {
+  Channel *found = channels_.find(channelname);
+  if (!found) {
     return;
   }
 
-  Channel &channel = channels_[channelname];
+  Channel &channel = *found;
   const Client &client = clients_[fd_sender];
-  const std::string &clientname = client.get_nickname();
+  client_id sender = client.get_id();
 
   // If +n flag is set and user is not in the channel or
   // if +m flag is set and user is not an operator (+o) or speaker (+v)
-  if ((channel.checkflag(C_OUTSIDE) && !channel.is_user(clientname)) ||
-      (channel.checkflag(C_MODERATED) && !channel.is_operator(clientname) &&
-       !channel.is_speaker(clientname)) ||
-      channel.is_banned(clientname, client.get_username(),
-                        client.get_hostname()))
+  if ((channel.checkflag(C_OUTSIDE) && !channel.is_user(sender)) ||
+      (channel.checkflag(C_MODERATED) && !channel.is_operator(sender) &&
+       !channel.is_speaker(sender)) ||
+      channel.is_banned(client))
     return;
 
-  const std::vector<std::string> &userlist = channel.get_users();
-
-  for (size_t i = 0; i < userlist.size(); ++i) {
-    std::stringstream servermessage;
-    std::string username = userlist[i];
-    std::string sendername = clients_[fd_sender].get_nickname();
-    if (sendername != username) {
-      servermessage << ":" << client.get_nickmask() << " NOTICE " << channelname
-                    << " :" << message;
-      queue_.push(std::make_pair(map_name_fd_[username], servermessage.str()));
-    }
-  }
+  std::stringstream servermessage;
+  servermessage << ":" << client.get_nickmask() << " NOTICE " << channelname
+                << " :" << message;
+  send_message_to_channel_(channel, servermessage.str(), fd_sender, SEND_LOW);
+  charge_flood_(clients_[fd_sender], RATE_NORMAL,
+                (channel.get_members().size() - 1) / FLOOD_FANOUT_STEP);
 }
 
 void Server::notice_to_user_(int fd_sender, std::string nickname,
                              std::string message) {
-  if (map_name_fd_.find(nickname) == map_name_fd_.end())
-    return;
+  client_id recipient = nickname_to_id_(nickname);
+  if (!recipient) return;
 
   std::stringstream servermessage;
   servermessage << ":" << clients_[fd_sender].get_nickmask() << " NOTICE "
                 << nickname << " :" << message;
-  queue_.push(std::make_pair(map_name_fd_[nickname], servermessage.str()));
+  queue_message_(ClientTable::fd_of(recipient), servermessage.str());
 }
 
 } // namespace irc
\ No newline at end of file
@@ -7,22 +7,21 @@ void Server::kill_(int fd, std::vector<std::string> &message) {
   Client &client = clients_[fd];
   if (!client.get_server_operator_status()) {
     // 481,"Permission Denied- You're not an IRC operator"
-    queue_.push(
-        std::make_pair(fd, numeric_reply_(481, fd, "")));
+    send_numeric_(481, fd, "");
     return;
   }
   if (message.size() < 3) {
     // Error 461: Not enough parameters
-    queue_.push(
-        std::make_pair(fd, numeric_reply_(461, fd, "KILL")));
+    send_numeric_(461, fd, "KILL");
     return;
   }
-  if (!map_name_fd_.count(message.at(1))) {
+  client_id victim = nickname_to_id_(message.at(1));
+  if (!victim) {
     // 401 no such nickname
-    queue_.push(std::make_pair(fd, numeric_reply_(401, fd, message[1])));
+    send_numeric_(401, fd, message[1]);
     return;
   }
-  int victimfd = map_name_fd_[message[1]];
+  int victimfd = ClientTable::fd_of(victim);
   std::stringstream reason;
   //reason << "Killed(" << client.get_nickname() + "(" + message[2] + "))";
   reason << "Killed (by " << client.get_nickname() + ") " + message[2];
@@ -30,8 +29,7 @@ void Server::kill_(int fd, std::vector<std::string> &message) {
 
   std::stringstream killmessage;
   killmessage << ":" << client.get_nickmask() << " ERROR :Closing link: " << server_name_ << " " << reason.str();
-  std::pair<int, std::string> killmsg(victimfd, killmessage.str());
-  send_message_(killmsg);
+  queue_message_(victimfd, killmessage.str());
 
   std::vector<std::string> quitmessage(1, "QUIT");
   quitmessage.push_back(reason.str());
@@ -52,7 +50,7 @@ void Server::part_(int fd, std::vector<std::string> &message) {
 
   if (message.size() < 2) {
     // Error 461: Not enough parameters
-    queue_.push(std::make_pair(fd, numeric_reply_(461, fd, "PART")));
+    send_numeric_(461, fd, "PART");
     return;
   }
 
@@ -61,37 +59,33 @@ void Server::part_(int fd, std::vector<std::string> &message) {
   // Leave every channel on the list individually
   for (size_t i = 0; i < channellist.size(); ++i) {
     std::string &channelname = channellist[i];
-    std::map<std::string, Channel,
-             irc_stringmapcomparator<std::string> >::iterator it =
-        channels_.find(channelname);
+    Channel *found = channels_.find(channelname);
 
     // Does the channel exist?
-    if (it == channels_.end()) {
+    if (!found) {
       // Error 403: No such channel
-      queue_.push(std::make_pair(fd, numeric_reply_(403, fd, channellist[i])));
+      send_numeric_(403, fd, channellist[i]);
       continue;
     }
 
-    Channel &channel = (*it).second;
-    const std::vector<std::string> &users_in_channel = channel.get_users();
+    Channel &channel = *found;
 
     // Is client a member of that channel?
-    if (std::find(users_in_channel.begin(), users_in_channel.end(),
-                  clientname) == users_in_channel.end()) {
+    if (!channel.is_user(client.get_id())) {
       // Error 442: You're not on that channel
-      queue_.push(std::make_pair(fd, numeric_reply_(442, fd, channelname)));
+      send_numeric_(442, fd, channelname);
       continue;
     }
 
     // If client is the last one in the channel, delete the channel
-    if (channel.get_users().size() == 1) {
+    if (channel.get_member_count() == 1) {
       channels_.erase(channelname);
       std::stringstream servermessage;
       servermessage << ":" << clientname << " PART " << channelname;
-      queue_.push(std::make_pair(fd, servermessage.str()));
+      queue_message_(fd, servermessage.str());
     } else {
       RPL_CHANNELCMD(channel, client, "PART");
-      channel.remove_user(clientname);
+      channel.remove_user(client.get_id());
     }
   }
 }
@@ -121,20 +115,38 @@ void Server::quit_(int fd, std::vector<std::string> &message) {
 
   // In all channels: quit it, then send a quit message.
   const std::string quitstr = quitmessage.str();
-  const std::string &clientname = client.get_nickname();
   for (size_t i = 0; i < channellist.size(); ++i) {
-    Channel &current_channel = channels_[channellist[i]];
-    current_channel.remove_user(clientname);
-    if (current_channel.get_users().empty())
-      channels_.erase(current_channel.get_channelname());
+    Channel *current_channel = channels_.find(channellist[i]);
+    if (!current_channel) continue;
+    current_channel->remove_user(client.get_id());
+    if (!current_channel->get_member_count())
+      channels_.erase(channellist[i]);
     else
-      send_message_to_channel_(current_channel, quitstr);
+      send_message_to_channel_(*current_channel, quitstr);
   }
 
-  map_name_fd_.erase(client.get_nickname());
+  map_name_id_.erase(client.get_nickname());
   disconnect_client_(fd);
 }
 
+/**
+ * @brief Ends a connection on the server's initiative: the client gets an
+ * ERROR with the reason, its channels see it QUIT with the same reason.
+ *
+ * @param fd the client's file descriptor
+ * @param reason why the link is closed, e.g. "Ping timeout"
+ */
+void Server::close_link_(int fd, const std::string &reason) {
+  std::stringstream servermessage;
+  servermessage << "ERROR :Closing Link: " << clients_[fd].get_nickname()
+                << " by " << server_name_ << " (" << reason << ")";
+  queue_message_(fd, servermessage.str());
+
+  std::vector<std::string> quitmessage(1, "QUIT");
+  quitmessage.push_back(reason);
+  quit_(fd, quitmessage);
+}
+
 /**
  * @brief the KICK command can be  used  to  forcibly  remove  a  user  from  a
    channel. It 'kicks them out' of the channel (forced PART). Only a channel
@@ -146,11 +158,10 @@ void Server::quit_(int fd, std::vector<std::string> &message) {
  */
 void Server::kick_(int fd, std::vector<std::string> &message) {
   Client &client = clients_[fd];
-  const std::string &clientname = client.get_nickname();
 
   if (message.size() < 3) {
     // Error 461: Not enough parameters
-    queue_.push(std::make_pair(fd, numeric_reply_(461, fd, "KICK")));
+    send_numeric_(461, fd, "KICK");
     return;
   }
 
@@ -160,36 +171,35 @@ void Server::kick_(int fd, std::vector<std::string> &message) {
   // Is the channelname valid?
   if (!join_valid_channel_name_(channelname)) {
     // Error 476: Bad Channel Mask
-    queue_.push(std::make_pair(fd, numeric_reply_(476, fd, channelname)));
+    send_numeric_(476, fd, channelname);
     return;
   }
 
-  std::map<std::string, Channel, irc_stringmapcomparator<std::string> >::iterator
-      it = channels_.find(channelname);
+  Channel *found = channels_.find(channelname);
 
   // Does the channel exist?
-  if (it == channels_.end()) {
+  if (!found) {
     // Error 403: No such channel
-    queue_.push(std::make_pair(fd, numeric_reply_(403, fd, channelname)));
+    send_numeric_(403, fd, channelname);
     return;
   }
 
-  Channel &channel = (*it).second;
+  Channel &channel = *found;
 
-  if (!channel.is_user(clientname)) {
+  if (!channel.is_user(client.get_id())) {
     // Error 442: You're not on that channel
-    queue_.push(std::make_pair(fd, numeric_reply_(442, fd, channelname)));
+    send_numeric_(442, fd, channelname);
     return;
   }
-  if (!channel.is_operator(clientname)) {
+  if (!channel.is_operator(client.get_id())) {
     // Error 482: You're not channel operator
-    queue_.push(std::make_pair(fd, numeric_reply_(482, fd, channelname)));
+    send_numeric_(482, fd, channelname);
     return;
   }
-  if (!channel.is_user(victimname)) {
+  client_id victim = nickname_to_id_(victimname);
+  if (!channel.is_user(victim)) {
     // Error 441: They aren't on that channel
-    queue_.push(std::make_pair(
-        fd, numeric_reply_(441, fd, victimname + " " + channelname)));
+    send_numeric_(441, fd, victimname + " " + channelname);
     return;
   }
 
@@ -208,7 +218,7 @@ void Server::kick_(int fd, std::vector<std::string> &message) {
   send_message_to_channel_(channel, servermessage.str());
 
   // Finally kick them!
-  channel.remove_user(victimname);
+  channel.remove_user(victim);
   client.remove_channel(channelname);
 }
 
@@ -2,14 +2,36 @@
 
 namespace irc {
 
-bool running = 1;
+static int shutdown_fd = -1;
+// Set by SIGHUP, the next loop iteration reloads the MOTD. Atomic, as the
+// handler may run on another thread than the reactor reading it.
+static int reload_requested = 0;
+static int reload_wake_fd = -1;
 
+// Async-signal-safe; the shutdown eventfd is never read, so every reactor
+// gets it reported
+static void post_eventfd(int fd) {
+  uint64_t one = 1;
+  if (fd >= 0 && write(fd, &one, sizeof(one)) < 0) return;
+}
+
+// Both handlers keep errno, the interrupted thread may be about to test it
 static void signalhandler(int signal) {
+  int saved = errno;
   (void)signal;
 #if DEBUG
   std::cout << "Signalcode: " << signal << std::endl;
 #endif
-  running = 0;
+  post_eventfd(shutdown_fd);
+  errno = saved;
+}
+
+static void reloadhandler(int signal) {
+  int saved = errno;
+  (void)signal;
+  __atomic_store_n(&reload_requested, 1, __ATOMIC_RELEASE);
+  post_eventfd(reload_wake_fd);
+  errno = saved;
 }
 
 void Server::run() {
@@ -17,122 +39,492 @@ void Server::run() {
     throw std::runtime_error(
         "Server not running. Canceled trying to run server.");
 
-  epoll_init_();
+  for (size_t i = 0; i < reactors_.size(); ++i) {
+    reactor &r = reactors_[i];
+    r.backend = EventBackend::create(config_);
+    r.backend->watch(r.listen_fd, r.wake_fd, shutdown_fd_);
+  }
+  shutdown_fd = shutdown_fd_;
   signal(SIGTSTP, signalhandler);
-
-  struct epoll_event postbox[MAX_CLIENTS + 1];
-  std::vector<std::string> message;
+  reload_wake_fd = reactors_[0].wake_fd;
+  signal(SIGHUP, reloadhandler);
 
   std::cout << "Server is now running. For safe exit, send ^Z (SIGTSTP)"
             << std::endl;
-
-  while (running) {
-    check_open_ping_responses_();
-    int fds_ready = epoll_wait(epoll_fd_, postbox, MAX_CLIENTS + 1, 100);
-    if (fds_ready > 0) {
-      for (int i = 0; i < fds_ready; i++) {
-        if (postbox[i].data.fd == socket_fd_) {
-          try {
-            create_new_client_connection_(postbox[i].data.fd);
-          } catch (std::exception &e) {
 #if DEBUG
-            std::cout << "Failed to add client connection" << std::endl;
+  std::cout << "Using " << kernels.name << " byte kernels" << std::endl;
+  std::cout << "Using " << reactors_[0].backend->name() << " for socket I/O"
+            << std::endl;
 #endif
-          }
-        } else {
-          read_from_client_fd_(postbox[i].data.fd);
-          message = get_next_message_(client_buffers_[postbox[i].data.fd]);
-          while (!message.empty()) {
-            process_message_(postbox[i].data.fd, message);
-            message = get_next_message_(client_buffers_[postbox[i].data.fd]);
-          }
-        }
-      }
-    }
-    while (!queue_.empty()) {
-      send_message_(queue_.front());
-      queue_.pop();
+
+  resolver_.start(config_.resolver_threads, config_.dns_cache_ttl);
+
+  // The calling thread is reactor 0, the others get a thread each
+  for (size_t i = 1; i < reactors_.size(); ++i) {
+    if (pthread_create(&reactors_[i].thread, NULL, &Server::reactor_main_,
+                       &reactors_[i]) != 0) {
+      post_eventfd(shutdown_fd_);
+      for (size_t j = 1; j < i; ++j) pthread_join(reactors_[j].thread, NULL);
+      throw std::runtime_error("Failed to start event loop thread");
     }
   }
-  std::map<int, Client>::iterator it = clients_.begin();
-  std::map<int, Client>::iterator end = clients_.end();
-  while (it != end) {
-    close(it++->first);
+  // Without its thread the export is just off
+  if (metrics_fd_ >= 0 && pthread_create(&metrics_thread_, NULL,
+                                         &Server::metrics_main_, this) != 0) {
+    std::cout << "Failed to start the metrics export" << std::endl;
+    close(metrics_fd_);
+    metrics_fd_ = -1;
   }
-  close(epoll_fd_);
+  reactor_loop_(reactors_[0]);
+  for (size_t i = 1; i < reactors_.size(); ++i)
+    pthread_join(reactors_[i].thread, NULL);
+  if (metrics_fd_ >= 0) pthread_join(metrics_thread_, NULL);
+  resolver_.stop();
+
+  const std::vector<int> &fds = clients_.fds();
+  for (size_t i = 0; i < fds.size(); ++i) close(fds[i]);
+  clients_.clear();
+  for (size_t i = 0; i < reactors_.size(); ++i)
+    for (size_t j = 0; j < reactors_[i].pending_close.size(); ++j)
+      close(reactors_[i].pending_close[j]);
 }
 
-void Server::check_open_ping_responses_() {
-  std::set<int>::iterator it = open_ping_responses_.begin();
-  std::set<int>::iterator end = open_ping_responses_.end();
-  while (it != end) {
-    Client &client = clients_[*it];
-    if (client.get_ping_status())
-      open_ping_responses_.erase(it++);
-    else if (time(NULL) - client.get_ping_time() > 60) {
-#if DEBUG
-      std::cout << "Timeout! Disconnecting client " << *it << std::endl;
-#endif
-      std::stringstream servermessage;
-      servermessage << "Error :Closing Link: " << client.get_nickname()
-                    << " by " << server_name_;
-      if (client.is_authorized()) {
-        servermessage << " (Ping timeout)";
-      } else {
-        servermessage << " (Registration Timeout)";
+void *Server::reactor_main_(void *arg) {
+  reactor *r = static_cast<reactor *>(arg);
+  r->server->reactor_loop_(*r);
+  return NULL;
+}
+
+static void begin_trace(loop_trace &trace) {
+  trace.mark = monotonic_us();
+  memset(trace.phase_us, 0, sizeof(trace.phase_us));
+  trace.dispatch_us = 0;
+  trace.command = NULL;
+  trace.command_us = 0;
+}
+
+// Ends a phase of the loop iteration; the command handlers that ran in it
+// count as dispatch
+static void end_phase(loop_trace &trace, loop_phase phase) {
+  uint64_t now = monotonic_us();
+  uint64_t spent = now - trace.mark;
+  trace.phase_us[phase] += spent - std::min(spent, trace.dispatch_us);
+  trace.phase_us[PHASE_DISPATCH] += trace.dispatch_us;
+  trace.dispatch_us = 0;
+  trace.mark = now;
+}
+
+// The iteration's time without the wait for events
+static uint64_t trace_total(const loop_trace &trace) {
+  uint64_t total = 0;
+  for (size_t i = 0; i < LOOP_PHASES; ++i) total += trace.phase_us[i];
+  return total;
+}
+
+/**
+ * @brief Event loop of one reactor. Sending, waiting, accepting, reading and
+ * cutting lines only touch the reactor's own fds and buffers and run
+ * concurrently with the other reactors; the collected events are then
+ * handled under the server lock, serialized with every other reactor.
+ *
+ * @param r the reactor owned by the calling thread
+ */
+void Server::reactor_loop_(reactor &r) {
+  while (!r.stopping) {
+    begin_trace(r.trace);
+    // What the last iteration queued for the reactor's connections
+    r.backend->submit();
+    end_phase(r.trace, PHASE_SEND);
+    // Connections cut off by the read limit still have data waiting;
+    // otherwise sleep until the next deadline
+    int timeout = r.read_again.empty() ? r.wait_ms : 0;
+    r.events.clear();
+    int n_events = r.backend->wait(r.events, timeout);
+    // Idle time is no part of the iteration
+    r.trace.mark = monotonic_us();
+    std::vector<int> read_again;
+    read_again.swap(r.read_again);
+    for (size_t i = 0; i < read_again.size(); ++i)
+      read_from_client_fd_(r, read_again[i]);
+    for (size_t i = 0; i < r.events.size(); ++i)
+      handle_io_event_(r, r.events[i]);
+    // Interrupted: nothing to do. A timeout still runs the due timers
+    if (n_events < 0 && read_again.empty()) continue;
+
+    end_phase(r.trace, PHASE_READ);
+    pthread_mutex_lock(&state_lock_);
+    end_phase(r.trace, PHASE_LOCK);
+    current_reactor_ = &r;
+    process_reactor_events_(r);
+    loop_time_.observe(trace_total(r.trace));
+    std::string stall = stall_record_(r);
+    current_reactor_ = NULL;
+    pthread_mutex_unlock(&state_lock_);
+    // Logged without the lock, a slow stdout only holds up this reactor
+    if (!stall.empty() && write(STDOUT_FILENO, stall.data(), stall.size()) < 0)
+      continue;
+  }
+}
+
+/**
+ * @brief Sorts what the backend reported for phase two; only the reactor's
+ * own fds are touched here.
+ */
+void Server::handle_io_event_(reactor &r, const io_event &event) {
+  switch (event.type) {
+    case IO_ACCEPT_READY:
+      accept_client_connection_(r);
+      break;
+    case IO_ACCEPTED: {
+      struct sockaddr_in client_addr;
+      socklen_t client_len = sizeof(client_addr);
+      memset(&client_addr, 0, sizeof(client_addr));
+      getpeername(event.fd, (struct sockaddr *)&client_addr, &client_len);
+      r.accepted.push_back(std::make_pair(event.fd, client_addr));
+      break;
+    }
+    case IO_ACCEPT_FAILED:
+      accept_failed_(r, -event.result);
+      break;
+    case IO_READABLE:
+      read_from_client_fd_(r, event.fd);
+      break;
+    case IO_DATA:
+    case IO_EOF:
+      stage_client_data_(r, event);
+      break;
+    case IO_WRITABLE:
+      // The socket drained: push out what is still queued for it
+      r.writable.push_back(event.fd);
+      break;
+    case IO_SENT:
+      r.sent.push_back(event);
+      break;
+    case IO_WAKE:
+      if (event.fd == r.wake_fd) {
+        uint64_t count;
+        if (read(r.wake_fd, &count, sizeof(count)) < 0) break;
+      } else if (event.fd == shutdown_fd_) {
+        r.stopping = true;
       }
-      queue_.push(std::make_pair(*it, servermessage.str()));
-      disconnect_client_(*it++);
-    } else
-      ++it;
+      break;
   }
 }
 
-void Server::epoll_init_() {
-  epoll_fd_ = epoll_create(MAX_CLIENTS);
+void Server::process_reactor_events_(reactor &r) {
+  update_clock_();
+  if (__atomic_exchange_n(&reload_requested, 0, __ATOMIC_ACQ_REL))
+    load_motd_();
+  apply_resolved_hostnames_();
 
-  if (epoll_fd_ < 0)
-    throw std::runtime_error("Failed to create epoll instance");
+  counters_.connections_rejected += r.accepts_shed;
+  counters_.accept_errors += r.accepts_failed;
+  r.accepts_shed = 0;
+  r.accepts_failed = 0;
+  if (r.accept_paused) resume_accepting_(r);
+  for (size_t i = 0; i < r.accepted.size(); ++i)
+    create_new_client_connection_(r, r.accepted[i].first,
+                                  r.accepted[i].second);
+  r.accepted.clear();
+  end_phase(r.trace, PHASE_ACCEPT);
 
-#if DEBUG
-  std::cout << "Created epoll fd" << std::endl;
-#endif
+  for (size_t i = 0; i < r.sent.size(); ++i) complete_send_(r, r.sent[i]);
+  r.sent.clear();
+  for (size_t i = 0; i < r.writable.size(); ++i) flush_client_(r.writable[i]);
+  r.writable.clear();
+  end_phase(r.trace, PHASE_SEND);
 
-  struct epoll_event event;
-  memset(&event, 0, sizeof(event));
-  event.events = EPOLLIN;
-  event.data.fd = socket_fd_;
+  for (size_t i = 0; i < r.reads.size(); ++i) {
+    const pending_read &staged = r.reads[i];
+    // Dropped by another reactor in the meantime, the data is stale
+    Client *client = clients_.find(staged.fd);
+    if (!client || client->get_reactor() != r.index ||
+        !r.backend->is_current(staged.fd, staged.tag))
+      continue;
 
-  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_fd_, &event) < 0) {
-    close(epoll_fd_);
-    throw std::runtime_error(
-        "Failed to add socket file descriptor to epoll list");
+    if (staged.size) {
+      counters_.bytes_received += staged.size;
+      client->set_last_active(clock_tick_());
+    }
+    if (staged.eof) {
+      // What the client sent before it left still runs, all of it
+      process_client_input_(r, staged.fd, *client, (size_t)-1);
+      if (!clients_.find(staged.fd)) continue;
+      std::vector<std::string> quitmessage(1, "QUIT");
+      quitmessage.push_back("EOF from client");
+      quit_(staged.fd, quitmessage);
+    } else if (staged.size && !client->is_runnable()) {
+      client->set_runnable(true);
+      r.runnable.push_back(client->get_id());
+    }
   }
+  r.reads.clear();
+
+  run_input_turns_(r);
+  end_phase(r.trace, PHASE_PARSE);
+  resume_deferred_(r);
+  run_timers_(r);
+  end_phase(r.trace, PHASE_TIMERS);
+  drop_slow_consumers_();
+  flush_pending_output_();
+
+  // The backend lets go of removed connections before their fds are closed
+  r.backend->rearm();
+  for (size_t i = 0; i < r.pending_close.size(); ++i)
+    close_connection_(r, r.pending_close[i]);
+  r.pending_close.clear();
+  // Sends queued on another reactor's backend may only start once its owner
+  // enters the kernel
+  for (size_t i = 0; i < reactors_.size(); ++i)
+    if (reactors_[i].backend->needs_wake() && i != r.index)
+      wake_reactor_(reactors_[i]);
+  r.wait_ms = next_wait_ms_(r);
+  end_phase(r.trace, PHASE_FLUSH);
+}
+
+/**
+ * @brief Formats a loop iteration that overran the stall budget as one
+ * key=value line: the time of every phase and the slowest command with its
+ * client and channel. At most one record per STALL_LOG_INTERVAL_MS is
+ * logged, the stalls in between are only counted.
+ *
+ * @return the record to log once the lock is released, empty if none
+ */
+std::string Server::stall_record_(const reactor &r) {
+  static const char *phase_names[LOOP_PHASES] = {
+      "read", "lock", "accept", "send", "parse", "dispatch", "timers", "flush"};
+  const loop_trace &trace = r.trace;
+  uint64_t total = trace_total(trace);
+  if (!config_.stall_budget || total < (uint64_t)config_.stall_budget * 1000)
+    return "";
+
+  ++counters_.loop_stalls;
+  if (stall_logged_ms_ &&
+      clock_ms_ < stall_logged_ms_ + STALL_LOG_INTERVAL_MS) {
+    ++stalls_suppressed_;
+    return "";
+  }
+  stall_logged_ms_ = clock_ms_;
+
+  std::ostringstream record;
+  record << "stall reactor=" << r.index << " total_us=" << (unsigned long)total
+         << " budget_ms=" << config_.stall_budget;
+  for (size_t i = 0; i < LOOP_PHASES; ++i)
+    record << ' ' << phase_names[i]
+           << "_us=" << (unsigned long)trace.phase_us[i];
+  if (trace.command) {
+    Client *client = clients_.find(trace.fd);
+    record << " command=" << trace.command << " command_us="
+           << (unsigned long)trace.command_us
+           << " fd=" << trace.fd << " client="
+           << (client && client->get_id() == trace.client &&
+                       !client->get_nickname().empty()
+                   ? client->get_nickname()
+                   : "*");
+    if (!trace.channel.empty()) record << " channel=" << trace.channel;
+  }
+  record << " suppressed=" << stalls_suppressed_ << '\n';
+  stalls_suppressed_ = 0;
+  return record.str();
+}
+
+void Server::wake_reactor_(const reactor &r) {
+  uint64_t one = 1;
+  if (write(r.wake_fd, &one, sizeof(one)) < 0) return;
+}
+
+/**
+ * @brief Reads the coarse monotonic clock. It is read once per loop
+ * iteration; everything in the iteration sees the same time.
+ */
+void Server::update_clock_() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+  clock_ms_ = (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Timer wheel ticks are whole seconds
+uint64_t Server::clock_tick_() const { return clock_ms_ / 1000; }
+
+/**
+ * @brief Replaces the client's deadline. The timer lives in the wheel of the
+ * reactor owning the connection.
+ *
+ * @param client the client
+ * @param deadline tick at which client_timer_expired_ runs for it
+ */
+void Server::arm_client_timer_(Client &client, uint64_t deadline) {
+  TimerWheel &timers = reactors_[client.get_reactor()].timers;
+  if (client.get_timer()) timers.cancel(client.get_timer());
+  client.set_timer(timers.arm(deadline, client.get_id()));
+}
+
+void Server::run_timers_(reactor &r) {
+  std::vector<client_id> expired;
+  r.timers.advance(clock_tick_(), expired);
+  for (size_t i = 0; i < expired.size(); ++i)
+    client_timer_expired_(expired[i]);
+}
 
+/**
+ * @brief Each connection has a single deadline. Before registration it is
+ * the registration timeout; afterwards it alternates between the keepalive
+ * interval (PING once the client went quiet) and the PONG timeout.
+ *
+ * @param id the client whose timer fired; it may be gone already
+ */
+void Server::client_timer_expired_(client_id id) {
+  if (!clients_.is_live(id)) return;
+
+  int fd = ClientTable::fd_of(id);
+  Client &client = clients_[fd];
+  client.set_timer(0);
+  uint64_t now = clock_tick_();
+
+  if (client.is_authorized() && client.get_ping_status()) {
+    // Traffic since the last check counts as a sign of life
+    if (now - client.get_last_active() < config_.ping_interval) {
+      arm_client_timer_(client,
+                        client.get_last_active() + config_.ping_interval);
+    } else {
+      ping_client_(fd);
+      arm_client_timer_(client, now + config_.ping_timeout);
+    }
+    return;
+  }
 #if DEBUG
-  std::cout << "Added socket to epoll API watchlist" << std::endl;
+  std::cout << "Timeout! Disconnecting client " << fd << std::endl;
 #endif
+  std::stringstream servermessage;
+  servermessage << "Error :Closing Link: " << client.get_nickname() << " by "
+                << server_name_;
+  if (client.is_authorized()) {
+    servermessage << " (Ping timeout)";
+  } else {
+    servermessage << " (Registration Timeout)";
+  }
+  queue_message_(fd, servermessage.str());
+  disconnect_client_(fd);
+}
+
+/**
+ * @brief Backend wait timeout until the reactor has work of its own: clients
+ * waiting for their turn, the next deadline, the end of an accept pause or
+ * the first deferred client whose rate allows it to go on. -1 sleeps until
+ * an event arrives.
+ */
+int Server::next_wait_ms_(const reactor &r) const {
+  if (!r.runnable.empty()) return 0;
+
+  uint64_t wake = TIMER_NONE;
+  uint64_t next = r.timers.next_expiry();
+  if (next != TIMER_NONE) wake = next * 1000;
+  if (r.accept_paused) wake = std::min(wake, r.accept_resume_ms);
+
+  uint64_t window = config_.flood_burst * config_.flood_interval;
+  for (size_t i = 0; i < r.deferred.size(); ++i) {
+    const Client *client = clients_.find(ClientTable::fd_of(r.deferred[i]));
+    if (client && client->get_id() == r.deferred[i])
+      wake = std::min(wake, client->get_flood_clock() - window);
+  }
+
+  if (wake == TIMER_NONE) return -1;
+  if (wake <= clock_ms_) return 0;
+  return std::min(wake - clock_ms_, (uint64_t)INT_MAX);
+}
+
+/**
+ * @brief Takes every connection waiting on the listener, up to the size of
+ * the backlog per wakeup, so a reconnect storm doesn't cost a loop iteration
+ * per client. They are set up together in the locked phase.
+ *
+ * @param r the reactor owning the listener
+ */
+void Server::accept_client_connection_(reactor &r) {
+  for (size_t i = 0; i < config_.listen_backlog; ++i) {
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+
+    // Replies are buffered per client, the socket itself must never block
+    int new_client_fd =
+        accept4(r.listen_fd, (struct sockaddr *)&client_addr, &client_len,
+                SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (new_client_fd >= 0) {
+      r.accepted.push_back(std::make_pair(new_client_fd, client_addr));
+      continue;
+    }
+    // Drained; another reactor may have been faster on a shared listener
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+    if (errno == EINTR || errno == ECONNABORTED) continue;
+    if (!accept_failed_(r, errno)) return;
+  }
 }
 
-void Server::create_new_client_connection_(int socket_fd_) {
-  struct epoll_event eventstruct;
-  struct sockaddr_in client_addr;
-  socklen_t client_len = sizeof(client_addr);
+/**
+ * @brief Out of fds the connection stays in the backlog and the listener
+ * keeps reporting it: the spare fd makes room to accept and close it. If the
+ * spare is gone as well, the listener is turned off for ACCEPT_PAUSE_MS.
+ *
+ * @param r the reactor whose accept failed
+ * @param error the errno of the accept
+ * @return true if a connection was shed and the backlog may hold more
+ */
+bool Server::accept_failed_(reactor &r, int error) {
+  if (error == EMFILE || error == ENFILE) {
+    if (shed_connection_(r)) {
+      ++r.accepts_shed;
+      return true;
+    }
+    if (!r.accept_paused) {
+      r.accept_paused = true;
+      r.accept_resume_ms = 0;
+      r.backend->set_accepting(false);
+    }
+  }
+  if (error != EAGAIN && error != EINTR && error != ECONNABORTED &&
+      error != ECANCELED)
+    ++r.accepts_failed;
+  return false;
+}
 
-  int new_client_fd =
-      accept(socket_fd_, (struct sockaddr *)&client_addr, &client_len);
+bool Server::shed_connection_(reactor &r) {
+  if (r.spare_fd >= 0) close(r.spare_fd);
+  int fd = accept4(r.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+  if (fd >= 0) close(fd);
+  // Another thread may have taken the fd; then this is retried next time
+  r.spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  return fd >= 0;
+}
 
-  if (new_client_fd < 0)
-    std::runtime_error("failed to accept client conenction");
+/**
+ * @brief Turns the listener back on once the pause is over, with a new spare
+ * fd if one is free by now. Still out of fds, the next accept pauses again.
+ */
+void Server::resume_accepting_(reactor &r) {
+  if (!r.accept_resume_ms) {
+    r.accept_resume_ms = clock_ms_ + ACCEPT_PAUSE_MS;
+    return;
+  }
+  if (clock_ms_ < r.accept_resume_ms) return;
 
-  memset(&eventstruct, 0, sizeof(eventstruct));
-  eventstruct.events = EPOLLIN;
-  eventstruct.data.fd = new_client_fd;
+  if (r.spare_fd < 0) r.spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  r.accept_paused = false;
+  r.backend->set_accepting(true);
+}
 
-  // Add new client fd to epoll api watchlist
-  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, new_client_fd, &eventstruct) < 0) {
-    std::runtime_error("failed to add client to watchlist");
+void Server::create_new_client_connection_(reactor &r, int new_client_fd,
+                                           struct sockaddr_in &client_addr) {
+  if (clients_.size() >= config_.max_clients) {
+    reject_client_connection_(new_client_fd, client_addr, "Server is full");
+    ++counters_.connections_rejected;
+    return;
   }
+  if (r.backend->add(new_client_fd) < 0) {
+    close(new_client_fd);
+    ++counters_.accept_errors;
+    return;
+  }
+  ++counters_.connections_accepted;
 #if DEBUG
   std::cout << "Added new client with fd " << new_client_fd << " to watchlist"
             << std::endl;
@@ -140,21 +532,22 @@ void Server::create_new_client_connection_(int socket_fd_) {
 
   // Initialize new client
 
-  char *client_ip = inet_ntoa(client_addr.sin_addr);
-  char hostname[NI_MAXHOST];
+  std::string client_ip = inet_ntoa(client_addr.sin_addr);
+  std::string hostname = client_ip;
 
-  if (getnameinfo((struct sockaddr *)&client_addr, client_len, hostname,
-                  NI_MAXHOST, NULL, 0, NI_NAMEREQD) != 0) {
-    std::cout << "Couldn't resolve hostname of client with fd " << new_client_fd
-              << std::endl;
-    close(new_client_fd);
-    return;
-  }
+  // The IP stands in as hostname until the reverse lookup has finished
+  bool resolving = resolver_.enabled() &&
+                   !resolver_.lookup_cache(client_addr.sin_addr, hostname);
 
   Client new_client;
   new_client.set_hostname(hostname);
   new_client.set_ip_addr(client_ip);
-  clients_.insert(std::make_pair(new_client_fd, new_client));
+  new_client.set_reactor(r.index);
+  new_client.set_reply_prefix(server_name_);
+  new_client.set_last_active(clock_tick_());
+  Client &client = clients_.insert(new_client_fd, new_client);
+  if (resolving) resolver_.submit(client.get_id(), r.wake_fd, client_addr);
+  arm_client_timer_(client, clock_tick_() + config_.registration_timeout);
   std::stringstream registrationprocess;
   registrationprocess
       << "You just connected to " << server_name_ << "!" << std::endl
@@ -164,7 +557,7 @@ void Server::create_new_client_connection_(int socket_fd_) {
       << "Enter the password with: PASS <password>" << std::endl
       << "Register nickname with: NICK <nickname>" << std::endl
       << "Register username with: USER <username> 0 * :<realname>";
-  send_message_(std::make_pair(new_client_fd, registrationprocess.str()));
+  queue_message_(new_client_fd, registrationprocess.str());
   ping_client_(new_client_fd);
 #if DEBUG
   std::cout << "Added new client hostname " << hostname << " and ip "
@@ -172,121 +565,542 @@ void Server::create_new_client_connection_(int socket_fd_) {
 #endif
 }
 
-void Server::read_from_client_fd_(int client_fd) {
-  static char buffer[BUFFERSIZE];
+/**
+ * @brief Turns a connection away before it becomes a client. The ERROR is
+ * sent with a single non-blocking send(); if the socket doesn't take it the
+ * client only sees the connection close.
+ *
+ * @param fd the freshly accepted socket
+ * @param client_addr the peer's address
+ * @param reason reason shown in the ERROR message
+ */
+void Server::reject_client_connection_(int fd, struct sockaddr_in &client_addr,
+                                       const std::string &reason) {
+  std::stringstream servermessage;
+  servermessage << "ERROR :Closing Link: " << inet_ntoa(client_addr.sin_addr)
+                << " by " << server_name_ << " (" << reason << ")\r\n";
+  const std::string &error = servermessage.str();
+  send(fd, error.data(), error.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+  close(fd);
+#if DEBUG
+  std::cout << "Rejected connection with fd " << fd << ": " << reason
+            << std::endl;
+#endif
+}
 
-  memset(&buffer, 0, BUFFERSIZE);
-  if (read(client_fd, buffer, BUFFERSIZE) < 1) {
-    std::vector<std::string> quitmessage(1, "QUIT");
-    quitmessage.push_back("EOF from client");
-    quit_(client_fd, quitmessage);
-    return;
+/**
+ * @brief Replaces the provisional hostname (the IP) of clients whose reverse
+ * lookup has finished. The result of a client that left is dropped, even if
+ * a new connection has its fd by now.
+ */
+void Server::apply_resolved_hostnames_() {
+  std::vector<resolved_host> results;
+  resolver_.collect(results);
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (!clients_.is_live(results[i].client)) continue;
+
+    int fd = ClientTable::fd_of(results[i].client);
+    Client &client = clients_[fd];
+    if (client.get_hostname() != client.get_ip_addr()) continue;
+    client.set_hostname(results[i].hostname);
+    forget_ban_status_(client);
+#if DEBUG
+    std::cout << "Resolved hostname of client with fd " << fd
+              << ": " << results[i].hostname << std::endl;
+#endif
+  }
+}
+
+// The owner's input buffer of the connection on fd
+static InputBuffer &input_of(reactor &r, int fd) {
+  if ((size_t)fd >= r.inputs.size()) r.inputs.resize(fd + 1, NULL);
+  if (!r.inputs[fd]) r.inputs[fd] = new InputBuffer();
+  return *r.inputs[fd];
+}
+
+/**
+ * @brief Reads everything the socket has (the fd is edge-triggered) into the
+ * connection's input buffer, up to the read limit per wakeup, and cuts it
+ * into lines. A connection that hits the limit is read again on the next
+ * loop iteration, after the other ready fds had their turn.
+ *
+ * @param r the reactor owning the connection
+ * @param client_fd the client's file descriptor
+ */
+void Server::read_from_client_fd_(reactor &r, int client_fd) {
+  pending_read staged;
+  staged.fd = client_fd;
+  staged.eof = false;
+  staged.tag = 0;
+  staged.size = 0;
+
+  InputBuffer &input = input_of(r, client_fd);
+  char chunk[BUFFERSIZE];
+  size_t budget = config_.read_limit;
+  while (budget) {
+    size_t wanted = std::min(budget, (size_t)BUFFERSIZE);
+    ssize_t n_read = read(client_fd, chunk, wanted);
+    if (n_read > 0) {
+      input.append(chunk, n_read);
+      staged.size += n_read;
+      budget -= n_read;
+      // A short read means the socket buffer is empty
+      if ((size_t)n_read < wanted) break;
+    } else if (n_read < 0 && errno == EINTR) {
+      continue;
+    } else {
+      if (n_read == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        staged.eof = true;
+      break;
+    }
   }
+  if (!budget) r.read_again.push_back(client_fd);
+
+  if (staged.size) input.parse();
+  if (staged.size || staged.eof) r.reads.push_back(staged);
 #if DEBUG
-  std::cout << "read " << buffer << std::endl;
+  std::cout << "read " << staged.size << " bytes from " << client_fd
+            << std::endl;
 #endif
-  client_buffers_[client_fd] += buffer;
+}
+
+/**
+ * @brief Takes bytes a completion backend already received out of its
+ * buffer, which is only valid until its next wait(). Those of a connection
+ * that is gone are dropped.
+ */
+void Server::stage_client_data_(reactor &r, const io_event &event) {
+  if (!r.backend->is_current(event.fd, event.tag)) return;
+
+  pending_read staged;
+  staged.fd = event.fd;
+  staged.eof = event.type == IO_EOF;
+  staged.tag = event.tag;
+  staged.size = event.type == IO_DATA ? event.size : 0;
+  if (staged.size) {
+    InputBuffer &input = input_of(r, event.fd);
+    input.append(event.data, staged.size);
+    input.parse();
+  }
+  r.reads.push_back(staged);
 }
 
 void Server::disconnect_client_(int client_fd) {
-  client_buffers_.erase(client_fd);
+  Client *client = clients_.find(client_fd);
+  if (!client) return;
+
+  // Last chance for a closing message (ERROR, KILL) to reach the client
+  reactor &owner = reactors_[client->get_reactor()];
+  owner.backend->send_final(client_fd, client->get_send_queue());
+
+  if (client->get_timer()) owner.timers.cancel(client->get_timer());
+  if (client->is_authorized()) --counters_.users;
+  if (client->get_server_operator_status()) --counters_.operators;
   clients_.erase(client_fd);
-  open_ping_responses_.erase(client_fd);
-  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, client_fd, NULL);
-  close(client_fd);
+  owner.backend->remove(client_fd);
+  // The owner may be reading this fd right now: it closes the fd itself at
+  // the end of its locked phase, so the number can't be reused under its feet
+  owner.pending_close.push_back(client_fd);
+  if (&owner != current_reactor_) wake_reactor_(owner);
 #if DEBUG
   std::cout << "Disconnected client " << client_fd << "!" << std::endl;
 #endif
 }
 
-void Server::process_message_(int fd, std::vector<std::string> &message) {
-  if (clients_[fd].is_authorized()) {
-    for (size_t i = 0; i < functions_.size(); ++i) {
-      if (irc_stringissame(functions_[i].first, message[0])) {
-        (this->*functions_[i].second)(fd, message);
-#if DEBUG
-        std::cout << "Executing a function " << message[0] << std::endl;
-#endif
-        return;
-      }
-    }
+/**
+ * @brief Closes a connection of the calling reactor. One that hit the read
+ * limit is still due for another read, and its unread input is left; neither
+ * may go to the next connection on the fd number.
+ *
+ * @param r the reactor owning the connection, running on this thread
+ * @param fd the connection's file descriptor
+ */
+void Server::close_connection_(reactor &r, int fd) {
+  std::vector<int>::iterator again =
+      std::find(r.read_again.begin(), r.read_again.end(), fd);
+  if (again != r.read_again.end()) r.read_again.erase(again);
+  if ((size_t)fd < r.inputs.size()) {
+    delete r.inputs[fd];
+    r.inputs[fd] = NULL;
+  }
+  close(fd);
+}
+
+/**
+ * @brief Looks the command up and checks what the table knows about it
+ * (registration, parameter count) before the handler is called. Only then
+ * is the argument vector for the handler filled.
+ *
+ * @param fd the client's file descriptor
+ * @param message the parsed line
+ */
+void Server::process_message_(int fd, const message_view &message) {
+  const command_entry *command = find_command(message.command);
+  charge_flood_(clients_[fd], command ? command->cost : RATE_NORMAL, 1);
+
+  if (!command) {
+    ++counters_.unknown_commands;
 #if DEBUG
-    std::cout << "Didn't find function " << message[0] << std::endl;
+    std::cout << "Didn't find function "
+              << std::string(message.command.data, message.command.size)
+              << std::endl;
 #endif
-  } else {
-    // If not authorized, only PASS, PONG, NICK, USER and QUIT are available
-    for (size_t i = 0; i < functions_unauthorized_.size(); ++i) {
-      if (irc_stringissame(functions_unauthorized_[i].first, message[0])) {
-        (this->*functions_unauthorized_[i].second)(fd, message);
+    return;
+  }
+  // If not authorized, only PASS, PONG, NICK, USER and QUIT are available
+  if (command->needs_registration && !clients_[fd].is_authorized()) return;
+  if (message.n_params < command->min_params) {
+    // Error 461: Not enough parameters
+    send_numeric_(461, fd, command->name);
+    return;
+  }
+
+  command_stats &stats = command_stats_[command - commands_];
+  ++stats.calls;
+  stats.bytes += message.size;
+  uint64_t started = monotonic_us();
+  message_view_to_vector(message, message_args_);
 #if DEBUG
-        std::cout << "Executing a function " << message[0] << std::endl;
+  std::cout << "Executing a function " << command->name << std::endl;
 #endif
-        return;
-      }
+  client_id sender = clients_[fd].get_id();
+  (this->*command->handler)(fd, message_args_);
+  uint64_t elapsed = monotonic_us() - started;
+  stats.latency.observe(elapsed);
+  if (current_reactor_)
+    trace_command_(current_reactor_->trace, command->name, sender, fd,
+                   elapsed);
+}
+
+/**
+ * @brief Takes the handler's time out of the running loop phase and keeps
+ * the slowest command of the iteration for the stall log.
+ */
+void Server::trace_command_(loop_trace &trace, const char *name,
+                            client_id sender, int fd, uint64_t elapsed) {
+  trace.dispatch_us += elapsed;
+  if (trace.command && elapsed <= trace.command_us) return;
+
+  trace.command = name;
+  trace.command_us = elapsed;
+  trace.client = sender;
+  trace.fd = fd;
+  trace.channel.clear();
+  // The target channel, e.g. of PRIVMSG #chan or INVITE nick #chan
+  for (size_t i = 1; i < message_args_.size() && i <= 2; ++i) {
+    const std::string &param = message_args_[i];
+    if (!param.empty() && (param[0] == '#' || param[0] == '&')) {
+      trace.channel = param;
+      break;
     }
-#if DEBUG
-    std::cout << "Didn't find function " << message[0]
-              << " in the vector for functions that are available when you are "
-                 "unauthorized"
-              << std::endl;
-#endif
   }
-  return;
 }
 
-std::vector<std::string> Server::get_next_message_(std::string &buffer) {
-  std::vector<std::string> ret;
-  size_t end_of_message = buffer.find("\r\n");
+/**
+ * @brief Executes the complete lines in the client's input buffer for as long
+ * as its flood control and the budget allow.
+ *
+ * @param r the reactor owning the connection
+ * @param fd the client's file descriptor
+ * @param budget the most lines to execute
+ * @return false if lines were left for later, true if the buffer holds no
+ * complete line anymore or the client is gone
+ */
+bool Server::process_client_input_(reactor &r, int fd, Client &client,
+                                   size_t budget) {
+  InputBuffer &buffer = input_of(r, fd);
 
-  if (end_of_message == std::string::npos) return ret;
+  for (; budget && !flood_exceeded_(client); --budget) {
+    if (!buffer.next_message(message_)) return true;
+    process_message_(fd, message_);
+    // The command may have ended the connection (QUIT)
+    if (!clients_.find(fd)) return true;
+  }
+  return false;
+}
 
-  std::string message = buffer.substr(0, end_of_message);
-  buffer.erase(0, end_of_message + 2);
+/**
+ * @brief Gives the client one turn at its input and enforces the input
+ * limits: the unprocessed lines of a client over its rate are capped by
+ * max_input_buffer, an incomplete line by max_line_length. A client over its
+ * rate is put on the reactor's deferred list, one that used up its turn on
+ * the runnable list; the latter isn't read from while max_input_buffer bytes
+ * wait.
+ *
+ * @param r the reactor owning the connection
+ * @param fd the client's file descriptor
+ * @return false if the client is gone
+ */
+bool Server::run_client_input_(reactor &r, int fd, Client &client) {
+  bool drained =
+      process_client_input_(r, fd, client, config_.messages_per_tick);
+  // Gone after QUIT
+  if (!clients_.find(fd)) return false;
 
-  // Looks for a prefix and discards it
-  size_t pos;
-  if (message.size() && message.at(0) == ':' &&
-      (pos = message.find(" ")) != std::string::npos)
-    message.erase(0, pos + 1);
+  InputBuffer &buffer = input_of(r, fd);
+  bool yielded = !drained && !flood_exceeded_(client);
+  bool held = yielded && buffer.size() >= config_.max_input_buffer;
+  r.backend->set_reading(fd, !held);
+  if (held) {
+    // Read again once reading resumes, not before
+    std::vector<int>::iterator again =
+        std::find(r.read_again.begin(), r.read_again.end(), fd);
+    if (again != r.read_again.end()) r.read_again.erase(again);
+  }
+  if (yielded) {
+    if (!client.is_runnable()) {
+      client.set_runnable(true);
+      r.runnable.push_back(client.get_id());
+    }
+    return true;
+  }
+  if (drained) {
+    // Whatever is left is an incomplete line
+    if (buffer.size() >= config_.max_line_length) {
+      close_link_(fd, "Input line too long");
+      return false;
+    }
+    return true;
+  }
+  if (buffer.size() > config_.max_input_buffer) {
+    close_link_(fd, "Excess Flood");
+    return false;
+  }
+  if (!client.is_deferred()) {
+    client.set_deferred(true);
+    r.deferred.push_back(client.get_id());
+  }
+  return true;
+}
+
+/**
+ * @brief Gives every client with lines waiting one turn of up to
+ * messages_per_tick lines, in the order they became runnable, so a client
+ * pipelining thousands of lines doesn't hold up the others. Who still has
+ * lines goes to the back of the list; the loop iteration's output is flushed
+ * before the next turn.
+ */
+void Server::run_input_turns_(reactor &r) {
+  if (r.runnable.empty()) return;
 
-  if (message.size() && message.at(0) == ':') {
-    ret.push_back(message.substr(1, message.size() - 1));
-    return ret;
+  std::vector<client_id> runnable;
+  runnable.swap(r.runnable);
+  for (size_t i = 0; i < runnable.size(); ++i) {
+    if (!clients_.is_live(runnable[i])) continue;
+    int fd = ClientTable::fd_of(runnable[i]);
+    Client &client = clients_[fd];
+    client.set_runnable(false);
+    run_client_input_(r, fd, client);
+  }
+}
+
+/**
+ * @brief Gives the deferred clients of the reactor another go. Those still
+ * over their rate stay on the list.
+ */
+void Server::resume_deferred_(reactor &r) {
+  if (r.deferred.empty()) return;
+
+  std::vector<client_id> deferred;
+  deferred.swap(r.deferred);
+  for (size_t i = 0; i < deferred.size(); ++i) {
+    if (!clients_.is_live(deferred[i])) continue;
+    int fd = ClientTable::fd_of(deferred[i]);
+    Client &client = clients_[fd];
+    client.set_deferred(false);
+    run_client_input_(r, fd, client);
+  }
+}
+
+/**
+ * @brief Takes the cost of a command from the client's token bucket. The
+ * bucket is a virtual clock that may run ahead of the real one by the burst
+ * window; an idle client's clock falls back to the present, which refills
+ * the bucket.
+ *
+ * @param client the client
+ * @param cost the command's rate class
+ * @param times how many times it is charged
+ */
+void Server::charge_flood_(Client &client, rate_class cost, size_t times) {
+  // Quarters of a normal command, indexed by rate_class
+  static const size_t weights[] = {1, 4, 16};
+
+  if (!config_.flood_interval || !times) return;
+  uint64_t flood_clock = std::max(client.get_flood_clock(), clock_ms_);
+  client.set_flood_clock(flood_clock + times * weights[cost] *
+                                           config_.flood_interval / 4);
+}
+
+// The bucket is empty: further lines wait until it refills
+bool Server::flood_exceeded_(const Client &client) const {
+  return client.get_flood_clock() >
+         clock_ms_ + config_.flood_burst * config_.flood_interval;
+}
+
+/**
+ * @brief Appends a message to the client's output queue. Nothing is written
+ * here; the client is scheduled for the flush at the end of the loop
+ * iteration.
+ *
+ * @param fd the recipient's file descriptor
+ * @param message the message without the trailing CRLF
+ */
+void Server::queue_message_(int fd, const std::string &message) {
+  if (!clients_.find(fd)) return;
+
+  ReplyBuilder reply(reply_to_(fd));
+  reply << message;
+  reply.send();
+}
+
+/**
+ * @brief Same as above for a message that is already formatted, so a
+ * broadcast only hands out references to one buffer.
+ *
+ * A low priority message to a client that is behind on reading is deferred
+ * behind its other output (sendq_defer) or dropped (sendq_drop); a client
+ * beyond max_sendq is disconnected.
+ *
+ * @param fd the recipient's file descriptor
+ * @param message the message including its CRLF
+ * @param priority SEND_LOW for chatter a slow reader may miss
+ */
+void Server::queue_message_(int fd, const SharedBuffer &message,
+                            send_priority priority) {
+  Client *client = clients_.find(fd);
+  if (!client || client->is_sendq_exceeded()) return;
+
+  SendQueue &queue = client->get_send_queue();
+  if (queue.size() + message.size() > config_.max_sendq) {
+    sendq_exceeded_(*client);
+    return;
   }
-  while ((pos = message.find(" ")) != std::string::npos) {
-    if (pos > 0) ret.push_back(message.substr(0, pos));
-    message.erase(0, pos + 1);
-    if (message.size() && message.at(0) == ':') {
-      ret.push_back(message.substr(1, message.size() - 1));
-      return ret;
+  if (priority == SEND_LOW && queue.size() > config_.sendq_drop) {
+    ++counters_.sendq_dropped;
+    return;
+  }
+  // Once one is deferred the later ones have to be as well, in order
+  if (priority == SEND_LOW &&
+      (queue.size() > config_.sendq_defer || queue.has_deferred())) {
+    queue.defer(message);
+    ++counters_.sendq_deferred;
+  } else {
+    queue.push(message);
+  }
+  ++counters_.messages_fanned_out;
+  reply_to_(fd);
+}
+
+/**
+ * @brief Schedules the flush of a client that is about to get a message, for
+ * formatting it in place with a ReplyBuilder.
+ *
+ * @param fd the recipient's file descriptor, must be live
+ * @return the recipient
+ */
+Client &Server::reply_to_(int fd) {
+  Client &client = clients_[fd];
+  // The reply still goes in, the client is dropped after this iteration
+  if (client.get_send_queue().size() > config_.max_sendq)
+    sendq_exceeded_(client);
+  if (!client.get_flush_scheduled()) {
+    client.set_flush_scheduled(true);
+    pending_flush_.push_back(fd);
+  }
+  return client;
+}
+
+/**
+ * @brief Marks a client whose output passed max_sendq. It can't be
+ * disconnected right away: a fanout may be walking the channel it is in.
+ */
+void Server::sendq_exceeded_(Client &client) {
+  if (client.is_sendq_exceeded()) return;
+  client.set_sendq_exceeded();
+  slow_consumers_.push_back(client.get_id());
+  ++counters_.sendq_exceeded;
+}
+
+void Server::drop_slow_consumers_() {
+  // Their QUIT may push further clients over the limit
+  while (!slow_consumers_.empty()) {
+    std::vector<client_id> dropped;
+    dropped.swap(slow_consumers_);
+    for (size_t i = 0; i < dropped.size(); ++i) {
+      if (!clients_.is_live(dropped[i])) continue;
+      int fd = ClientTable::fd_of(dropped[i]);
+      // Room for the ERROR, nothing else is going to be sent
+      clients_[fd].get_send_queue().clear();
+      close_link_(fd, "Max SendQ exceeded");
     }
   }
+}
 
-  if (!message.empty()) ret.push_back(message);
+/**
+ * @brief Hands the front of the client's queue to the backend of its reactor.
+ * The owner sends it once it released the lock; the result comes back as an
+ * IO_SENT.
+ *
+ * @param fd the client's file descriptor
+ */
+void Server::flush_client_(int fd) {
+  Client *found = clients_.find(fd);
+  if (!found) return;
 
-#if DEBUG
-  std::cout << "Parsed next message:";
-  for (size_t i = 0; i < ret.size(); ++i) {
-    std::cout << " " << ret[i];
+  Client &client = *found;
+  reactors_[client.get_reactor()].backend->send(fd, client.get_send_queue());
+}
+
+/**
+ * @brief A send of the reactor's backend completed. What it left over, and
+ * what was queued meanwhile, goes out with the next flush; unless the socket
+ * is full, then it waits for IO_WRITABLE. A broken connection is treated like
+ * an EOF.
+ */
+void Server::complete_send_(reactor &r, const io_event &event) {
+  Client *client = clients_.find(event.fd);
+  if (client && !r.backend->is_current(event.fd, event.tag)) client = NULL;
+  int status =
+      r.backend->send_done(event, client ? &client->get_send_queue() : NULL);
+  if (status < 0) {
+    write_error_(event.fd);
+    return;
   }
-  std::cout << std::endl;
-#endif
+  if (client && status == 0 && !client->get_send_queue().empty() &&
+      !client->get_flush_scheduled()) {
+    client->set_flush_scheduled(true);
+    pending_flush_.push_back(event.fd);
+  }
+}
 
-  return ret;
+void Server::write_error_(int fd) {
+  Client *client = clients_.find(fd);
+  if (!client) return;
+
+  client->get_send_queue().clear();
+  std::vector<std::string> quitmessage(1, "QUIT");
+  quitmessage.push_back("Write error");
+  quit_(fd, quitmessage);
 }
 
-void Server::send_message_(std::pair<int, std::string> message) {
-  write(message.first, message.second.c_str(), message.second.length());
-  write(message.first, "\r\n", 2);
+void Server::flush_pending_output_() {
+  // quit_ on a write error may schedule more clients, so no iterators here
+  for (size_t i = 0; i < pending_flush_.size(); ++i) {
+    Client *client = clients_.find(pending_flush_[i]);
+    if (!client) continue;
+    client->set_flush_scheduled(false);
+    flush_client_(pending_flush_[i]);
+  }
+  pending_flush_.clear();
 }
 
 void Server::ping_client_(int fd) {
   Client &client = clients_[fd];
   client.set_pingstatus(false);
   client.set_new_ping();
-  open_ping_responses_.insert(fd);
-  queue_.push(
-      std::make_pair(fd, "PING " + client.get_expected_ping_response()));
+  queue_message_(fd, "PING " + client.get_expected_ping_response());
 #if DEBUG
   std::cout << "Sent PING to client with fd " << fd
             << ". Expected response: " << client.get_expected_ping_response()
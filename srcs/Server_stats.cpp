@@ -0,0 +1,310 @@
+#include "Server.hpp"
+
+namespace irc {
+
+/**
+ * @brief STATS <query>, for operators: "m" counts the commands, "u" tells the
+ * uptime and "z" sums up the metrics. Other queries only get the end of the
+ * report.
+ *
+ * @param fd the client's file descriptor
+ * @param message message[1] is the query, its first letter counts
+ */
+void Server::stats_(int fd, std::vector<std::string> &message) {
+  if (!clients_[fd].get_server_operator_status()) {
+    // Error 481: Permission Denied
+    send_numeric_(481, fd, "");
+    return;
+  }
+  std::string query =
+      message.size() > 1 && !message[1].empty() ? message[1].substr(0, 1) : "*";
+
+  switch (query[0]) {
+    case 'm':
+      stats_commands_(fd);
+      break;
+    case 'u':
+      stats_uptime_(fd);
+      break;
+    case 'z':
+      stats_summary_(fd);
+      break;
+  }
+  // 219 RPL_ENDOFSTATS
+  send_numeric_(219, fd, query);
+}
+
+void Server::stats_commands_(int fd) {
+  Client &client = reply_to_(fd);
+  // 212 RPL_STATSCOMMANDS: <command> <count> <byte count> <remote count>
+  for (size_t i = 0; i < COMMAND_TABLE_SIZE; ++i) {
+    if (!commands_[i].name || !command_stats_[i].calls) continue;
+    ReplyBuilder reply(client, 212);
+    reply << ' ' << commands_[i].name << ' '
+          << (unsigned long)command_stats_[i].calls << ' '
+          << (unsigned long)command_stats_[i].bytes << " 0";
+    reply.send();
+  }
+}
+
+void Server::stats_uptime_(int fd) {
+  unsigned long uptime = std::time(NULL) - creation_time_;
+  unsigned long minutes = uptime / 60 % 60;
+  unsigned long seconds = uptime % 60;
+
+  // 242 RPL_STATSUPTIME
+  ReplyBuilder reply(reply_to_(fd), 242);
+  reply << " :Server Up " << uptime / 86400 << " days " << uptime / 3600 % 24
+        << (minutes < 10 ? ":0" : ":") << minutes << (seconds < 10 ? ":0" : ":")
+        << seconds;
+  reply.send();
+}
+
+/**
+ * @brief The metrics in short, as 249 RPL_STATSDEBUG lines; latencies are
+ * the upper bounds of their histogram buckets.
+ */
+void Server::stats_summary_(int fd) {
+  Client &client = reply_to_(fd);
+  size_t sendq_bytes = 0;
+  const std::vector<int> &fds = clients_.fds();
+  for (size_t i = 0; i < fds.size(); ++i)
+    sendq_bytes += clients_[fds[i]].get_send_queue().size();
+
+  {
+    ReplyBuilder reply(client, 249);
+    reply << " :Clients " << clients_.size() << " users " << counters_.users
+          << " operators " << counters_.operators << " channels "
+          << channels_.size() << " queued output " << sendq_bytes << " bytes";
+    reply.send();
+  }
+  {
+    ReplyBuilder reply(client, 249);
+    reply << " :Connections accepted " << counters_.connections_accepted
+          << " rejected " << counters_.connections_rejected << " failed "
+          << counters_.accept_errors << " registrations "
+          << counters_.registrations;
+    reply.send();
+  }
+  {
+    ReplyBuilder reply(client, 249);
+    reply << " :Bytes received " << counters_.bytes_received << " sent "
+          << (unsigned long)SendQueue::bytes_sent() << " messages fanned out "
+          << counters_.messages_fanned_out << " unknown commands "
+          << counters_.unknown_commands;
+    reply.send();
+  }
+  {
+    ReplyBuilder reply(client, 249);
+    reply << " :SendQ deferred " << counters_.sendq_deferred << " dropped "
+          << counters_.sendq_dropped << " exceeded "
+          << counters_.sendq_exceeded;
+    reply.send();
+  }
+  {
+    ReplyBuilder reply(client, 249);
+    reply << " :Loop iterations " << (unsigned long)loop_time_.count()
+          << " p50 " << (unsigned long)loop_time_.quantile(0.5) << "us p99 "
+          << (unsigned long)loop_time_.quantile(0.99) << "us stalls "
+          << counters_.loop_stalls;
+    reply.send();
+  }
+  for (size_t i = 0; i < COMMAND_TABLE_SIZE; ++i) {
+    const Histogram &latency = command_stats_[i].latency;
+    if (!commands_[i].name || !latency.count()) continue;
+    ReplyBuilder reply(client, 249);
+    reply << " :" << commands_[i].name << " p50 "
+          << (unsigned long)latency.quantile(0.5) << "us p99 "
+          << (unsigned long)latency.quantile(0.99) << "us";
+    reply.send();
+  }
+}
+
+void *Server::metrics_main_(void *arg) {
+  static_cast<Server *>(arg)->metrics_loop_();
+  return NULL;
+}
+
+/**
+ * @brief Serves the metrics export until the shutdown eventfd fires. Scrapes
+ * are rare, so they are answered one at a time on this thread; the server
+ * lock is only held to copy the numbers.
+ */
+void Server::metrics_loop_() {
+  struct pollfd fds[2];
+  fds[0].fd = metrics_fd_;
+  fds[0].events = POLLIN;
+  fds[1].fd = shutdown_fd_;
+  fds[1].events = POLLIN;
+
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    if (fds[1].revents) return;
+    int fd = accept4(metrics_fd_, NULL, NULL, SOCK_CLOEXEC);
+    if (fd >= 0) serve_metrics_(fd);
+  }
+}
+
+/**
+ * @brief Answers one scrape. A request starting with GET gets an HTTP
+ * response, anything else (nc, socat) just the metrics.
+ *
+ * @param fd the accepted admin connection, closed here
+ */
+void Server::serve_metrics_(int fd) {
+  struct timeval timeout;
+  timeout.tv_sec = 1;
+  timeout.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  char request[1024];
+  ssize_t n_read = 0;
+  struct pollfd readable;
+  readable.fd = fd;
+  readable.events = POLLIN;
+  if (poll(&readable, 1, METRICS_REQUEST_TIMEOUT_MS) > 0)
+    n_read = recv(fd, request, sizeof(request), 0);
+
+  std::ostringstream body;
+  write_metrics_(body);
+  std::string response = body.str();
+  if (n_read >= 3 && !memcmp(request, "GET", 3)) {
+    std::ostringstream header;
+    header << "HTTP/1.0 200 OK\r\n"
+           << "Content-Type: text/plain; version=0.0.4\r\n"
+           << "Content-Length: " << response.size() << "\r\n\r\n";
+    response = header.str() + response;
+  }
+
+  size_t sent = 0;
+  while (sent < response.size()) {
+    ssize_t n_sent = send(fd, response.data() + sent, response.size() - sent,
+                          MSG_NOSIGNAL);
+    if (n_sent <= 0) break;
+    sent += n_sent;
+  }
+  // Unread request bytes would turn the close into a reset
+  shutdown(fd, SHUT_WR);
+  while (poll(&readable, 1, METRICS_REQUEST_TIMEOUT_MS) > 0 &&
+         recv(fd, request, sizeof(request), 0) > 0)
+    continue;
+  close(fd);
+}
+
+// Copied with the server lock held, formatted after it is released
+struct metrics_snapshot {
+  server_counters counters;
+  command_stats commands[COMMAND_TABLE_SIZE];
+  Histogram loop_time;
+  size_t clients;
+  size_t channels;
+  size_t sendq_bytes;
+  uint64_t bytes_sent;
+};
+
+/**
+ * @brief The metrics in the Prometheus text format
+ */
+void Server::write_metrics_(std::ostream &out) {
+  metrics_snapshot snapshot;
+
+  pthread_mutex_lock(&state_lock_);
+  snapshot.counters = counters_;
+  for (size_t i = 0; i < COMMAND_TABLE_SIZE; ++i)
+    snapshot.commands[i] = command_stats_[i];
+  snapshot.loop_time = loop_time_;
+  snapshot.clients = clients_.size();
+  snapshot.channels = channels_.size();
+  snapshot.sendq_bytes = 0;
+  const std::vector<int> &fds = clients_.fds();
+  for (size_t i = 0; i < fds.size(); ++i)
+    snapshot.sendq_bytes += clients_[fds[i]].get_send_queue().size();
+  snapshot.bytes_sent = SendQueue::bytes_sent();
+  pthread_mutex_unlock(&state_lock_);
+
+  const server_counters &counters = snapshot.counters;
+  write_metric_header(out, "ircserv_connections_accepted_total", "counter",
+                      "Connections that became clients");
+  write_metric(out, "ircserv_connections_accepted_total", "",
+               counters.connections_accepted);
+  write_metric_header(out, "ircserv_connections_rejected_total", "counter",
+                      "Connections turned away (server full, out of fds)");
+  write_metric(out, "ircserv_connections_rejected_total", "",
+               counters.connections_rejected);
+  write_metric_header(out, "ircserv_accept_errors_total", "counter",
+                      "Accepts that failed otherwise");
+  write_metric(out, "ircserv_accept_errors_total", "", counters.accept_errors);
+  write_metric_header(out, "ircserv_registrations_total", "counter",
+                      "Clients that completed the registration");
+  write_metric(out, "ircserv_registrations_total", "", counters.registrations);
+
+  write_metric_header(out, "ircserv_commands_total", "counter",
+                      "Commands received, by command");
+  for (size_t i = 0; i < COMMAND_TABLE_SIZE; ++i)
+    if (commands_[i].name)
+      write_metric(out, "ircserv_commands_total",
+                   std::string("command=\"") + commands_[i].name + "\"",
+                   snapshot.commands[i].calls);
+  write_metric(out, "ircserv_commands_total", "command=\"unknown\"",
+               counters.unknown_commands);
+
+  write_metric_header(out, "ircserv_received_bytes_total", "counter",
+                      "Bytes read from clients");
+  write_metric(out, "ircserv_received_bytes_total", "",
+               counters.bytes_received);
+  write_metric_header(out, "ircserv_sent_bytes_total", "counter",
+                      "Bytes sent to clients");
+  write_metric(out, "ircserv_sent_bytes_total", "", snapshot.bytes_sent);
+  write_metric_header(out, "ircserv_messages_fanned_out_total", "counter",
+                      "Shared messages queued, one per recipient");
+  write_metric(out, "ircserv_messages_fanned_out_total", "",
+               counters.messages_fanned_out);
+  write_metric_header(out, "ircserv_sendq_deferred_total", "counter",
+                      "Channel messages deferred for slow readers");
+  write_metric(out, "ircserv_sendq_deferred_total", "",
+               counters.sendq_deferred);
+  write_metric_header(out, "ircserv_sendq_dropped_total", "counter",
+                      "Channel messages dropped for slow readers");
+  write_metric(out, "ircserv_sendq_dropped_total", "", counters.sendq_dropped);
+  write_metric_header(out, "ircserv_sendq_exceeded_total", "counter",
+                      "Clients disconnected for exceeding max_sendq");
+  write_metric(out, "ircserv_sendq_exceeded_total", "",
+               counters.sendq_exceeded);
+
+  write_metric_header(out, "ircserv_clients", "gauge",
+                      "Connections, registered or not");
+  write_metric(out, "ircserv_clients", "", snapshot.clients);
+  write_metric_header(out, "ircserv_users", "gauge", "Registered clients");
+  write_metric(out, "ircserv_users", "", counters.users);
+  write_metric_header(out, "ircserv_operators", "gauge", "IRC operators");
+  write_metric(out, "ircserv_operators", "", counters.operators);
+  write_metric_header(out, "ircserv_channels", "gauge", "Channels");
+  write_metric(out, "ircserv_channels", "", snapshot.channels);
+  write_metric_header(out, "ircserv_sendq_bytes", "gauge",
+                      "Output queued for all clients");
+  write_metric(out, "ircserv_sendq_bytes", "", snapshot.sendq_bytes);
+  write_metric_header(out, "ircserv_start_time_seconds", "gauge",
+                      "Unix time the server started");
+  write_metric(out, "ircserv_start_time_seconds", "", creation_time_);
+
+  write_metric_header(out, "ircserv_command_duration_seconds", "histogram",
+                      "Time spent in the command handlers");
+  for (size_t i = 0; i < COMMAND_TABLE_SIZE; ++i)
+    if (commands_[i].name)
+      snapshot.commands[i].latency.write(
+          out, "ircserv_command_duration_seconds",
+          std::string("command=\"") + commands_[i].name + "\"");
+  write_metric_header(out, "ircserv_loop_iteration_duration_seconds",
+                      "histogram",
+                      "Time a reactor spends on the events of one wakeup");
+  snapshot.loop_time.write(out, "ircserv_loop_iteration_duration_seconds",
+                            "");
+  write_metric_header(out, "ircserv_loop_stalls_total", "counter",
+                      "Loop iterations over the stall budget");
+  write_metric(out, "ircserv_loop_stalls_total", "", counters.loop_stalls);
+}
+
+}  // namespace irc
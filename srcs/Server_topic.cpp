@@ -18,23 +18,21 @@ void Server::topic_(int fd, std::vector<std::string> &message) {
 
   if (message.size() == 1) {
     // Error 461: Not enough parameters
-    queue_.push(std::make_pair(fd, numeric_reply_(461, fd, "TOPIC")));
+    send_numeric_(461, fd, "TOPIC");
     return;
   }
 
   std::string &channelname = message[1];
-  std::map<std::string, Channel,
-           irc_stringmapcomparator<std::string> >::iterator it =
-      channels_.find(channelname);
+  Channel *found = channels_.find(channelname);
 
   // Does the channel exist?
-  if (it == channels_.end()) {
+  if (!found) {
     // Error 403: No such channel
-    queue_.push(std::make_pair(fd, numeric_reply_(403, fd, channelname)));
+    send_numeric_(403, fd, channelname);
     return;
   }
 
-  Channel &channel = (*it).second;
+  Channel &channel = *found;
   if (message.size() == 2) {
     topic_send_info_(fd, channelname, channel);
   } else {
@@ -55,15 +53,11 @@ void Server::topic_(int fd, std::vector<std::string> &message) {
  */
 void Server::topic_send_info_(int fd, const std::string &channelname,
                               const Channel &channel) {
-  const std::string &clientname = clients_[fd].get_nickname();
-  std::stringstream prefix;
-  prefix << ":" << server_name_ << " ";
-
   if (channel.is_topic_set()) {
-    RPL_TOPIC(channel, clientname, fd);
-    RPL_TOPICWHOTIME(channel, clientname, fd);
+    RPL_TOPIC(channel, fd);
+    RPL_TOPICWHOTIME(channel, fd);
   } else {
-    RPL_NOTOPIC(clientname, channelname, fd);
+    RPL_NOTOPIC(channelname, fd);
   }
 }
 
@@ -81,9 +75,9 @@ void Server::topic_set_topic_(int fd, const std::string &channelname,
                               Channel &channel, const std::string &topicname) {
   const Client &client = clients_[fd];
   const std::string &clientname = client.get_nickname();
-  if (channel.checkflag(C_TOPIC) && !channel.is_operator(clientname)) {
+  if (channel.checkflag(C_TOPIC) && !channel.is_operator(client.get_id())) {
     // Error 482: You're not channel operator
-    queue_.push(std::make_pair(fd, numeric_reply_(482, fd, channelname)));
+    send_numeric_(482, fd, channelname);
     return;
   }
 
@@ -9,52 +9,25 @@ namespace irc {
  * @param fd the client's file descriptor
  */
 void Server::welcome_(int fd) {
-  std::string clientname = clients_[fd].get_nickname();
+  Client &client = reply_to_(fd);
+  // Runs once per client, when its last registration step arrives
+  ++counters_.registrations;
+  if (++counters_.users > counters_.peak_users)
+    counters_.peak_users = counters_.users;
+  const std::string &clientname = client.get_nickname();
 
   // 001 RPL_WELCOME
   {
-    std::stringstream servermessage;
-    servermessage << ":" << server_name_ << " 001 " << clientname
-                  << " :Welcome to ircserv, " << clientname;
-    queue_.push(std::make_pair(fd, servermessage.str()));
+    ReplyBuilder reply(client, 1);
+    reply << " :Welcome to ircserv, " << clientname;
+    reply.send();
   }
 
-  // 002 RPL_YOURHOST
-  {
-    std::stringstream servermessage;
-    servermessage << ":" << server_name_ << " 002 " << clientname
-                  << " :Your host is " << server_name_
-                  << ", running on version 1.0";
-    queue_.push(std::make_pair(fd, servermessage.str()));
-  }
-
-  // 003 RPL_CREATED
-  {
-    std::stringstream servermessage;
-    char timebuffer[80];
-    std::memset(&timebuffer, 0, sizeof(timebuffer));
-    std::strftime(timebuffer, sizeof(timebuffer), "%a %b %d %Y at %H:%M:%S %Z",
-                  std::localtime(&creation_time_));
-    servermessage << ":" << server_name_ << " 003 " << clientname
-                  << " :This server was created " << timebuffer;
-    queue_.push(std::make_pair(fd, servermessage.str()));
-  }
-
-  // 004 RPL_MYINFO
-  {
-    std::stringstream servermessage;
-    servermessage << ":" << server_name_ << " 004 " << clientname
-                  << " ircserv 1.0 so oitnmlbvk olbvk";
-    queue_.push(std::make_pair(fd, servermessage.str()));
-  }
-
-  // 005 RPL_ISUPPORT
-  {
-    std::stringstream servermessage;
-    servermessage << ":" << server_name_ << " 005 " << clientname
-                  << " MAXCHANNELS=10 NICKLEN=9 CHANMODES=b,k,l,imnt :are "
-                     "supported by this server";
-    queue_.push(std::make_pair(fd, servermessage.str()));
+  // 002 RPL_YOURHOST - 005 RPL_ISUPPORT
+  for (size_t i = 0; i < welcome_burst_.size(); ++i) {
+    ReplyBuilder reply(client, welcome_burst_[i].first);
+    reply << welcome_burst_[i].second;
+    reply.send();
   }
 
   // Empty helper vector
@@ -88,56 +61,36 @@ void Server::lusers_(int fd, std::vector<std::string> &message) {
 
   // 255 RPL_LUSERME (mandatory)
   lusers_me_(fd);
+
+  // 265 RPL_LOCALUSERS, 266 RPL_GLOBALUSERS
+  lusers_local_global_(fd);
 }
 
 void Server::lusers_client_op_unknown_(int fd) {
-  int n_users_invis = 0;
-  int n_users_non_invis = 0;
-  int n_operators = 0;
-  int n_unauthorized = 0;
-
-  std::map<int, Client>::iterator it = clients_.begin();
-  std::map<int, Client>::iterator end = clients_.end();
-
-  while (it != end) {
-    /* if ((*it).second.is_invisible())
-      ++n_users_invis;
-    else */
-    ++n_users_non_invis;
-
-    // if ((*it).second.is_operator()) ++n_operators;
-
-    if (!(*it).second.is_authorized()) ++n_unauthorized;
-
-    ++it;
-  }
+  // There is no +i user mode, nobody is invisible
+  size_t n_users_invis = 0;
+  size_t n_unauthorized = clients_.size() - counters_.users;
 
+  Client &client = reply_to_(fd);
   // 251 RPL_LUSERCLIENT (mandatory)
   {
-    std::stringstream servermessage;
-    servermessage << ":" << server_name_ << " 251 "
-                  << clients_[fd].get_nickname() << " :There are "
-                  << n_users_non_invis << " users and " << n_users_invis
-                  << " invisible on 1 servers";
-    queue_.push(std::make_pair(fd, servermessage.str()));
+    ReplyBuilder reply(client, 251);
+    reply << " :There are " << counters_.users << " users and "
+          << n_users_invis << " invisible on 1 servers";
+    reply.send();
   }
   // 252 RPL_LUSEROP (only if non-zero)
-  if (n_operators) {
-    std::stringstream servermessage;
-    servermessage << ":" << server_name_ << " 252 "
-                  << clients_[fd].get_nickname() << " " << n_operators
-                  << " :operator(s) online";
-    queue_.push(std::make_pair(fd, servermessage.str()));
+  if (counters_.operators) {
+    ReplyBuilder reply(client, 252);
+    reply << ' ' << counters_.operators << " :operator(s) online";
+    reply.send();
   }
 
   // 253 RPL_LUSERUNKNOWN (only if non-zero)
   if (n_unauthorized) {
-    std::stringstream servermessage;
-    servermessage.str(std::string());
-    servermessage << ":" << server_name_ << " 253 "
-                  << clients_[fd].get_nickname() << " " << n_unauthorized
-                  << " :unknown connection(s)";
-    queue_.push(std::make_pair(fd, servermessage.str()));
+    ReplyBuilder reply(client, 253);
+    reply << ' ' << n_unauthorized << " :unknown connection(s)";
+    reply.send();
   }
 }
 
@@ -145,19 +98,28 @@ void Server::lusers_channels_(int fd) {
   int n_channels = channels_.size();
 
   if (n_channels) {
-    std::stringstream servermessage;
-    servermessage << ":" << server_name_ << " 254 "
-                  << clients_[fd].get_nickname() << n_channels
-                  << " :channels formed";
-    queue_.push(std::make_pair(fd, servermessage.str()));
+    ReplyBuilder reply(reply_to_(fd), 254);
+    reply << ' ' << n_channels << " :channels formed";
+    reply.send();
   }
 }
 
 void Server::lusers_me_(int fd) {
-  std::stringstream servermessage;
-  servermessage << ":" << server_name_ << " 255 " << clients_[fd].get_nickname()
-                << " :I have " << clients_.size() << " clients and 1 servers";
-  queue_.push(std::make_pair(fd, servermessage.str()));
+  ReplyBuilder reply(reply_to_(fd), 255);
+  reply << " :I have " << clients_.size() << " clients and 1 servers";
+  reply.send();
+}
+
+void Server::lusers_local_global_(int fd) {
+  Client &client = reply_to_(fd);
+  // 265 RPL_LOCALUSERS, 266 RPL_GLOBALUSERS: one server, the same numbers
+  for (int number = 265; number <= 266; ++number) {
+    ReplyBuilder reply(client, number);
+    reply << ' ' << counters_.users << ' ' << counters_.peak_users
+          << " :Current users " << counters_.users << ", max "
+          << counters_.peak_users;
+    reply.send();
+  }
 }
 
 /**
@@ -171,7 +133,7 @@ void Server::lusers_me_(int fd) {
 void Server::motd_(int fd, std::vector<std::string> &message) {
   if (message.size() > 1 && message[1].compare(server_name_) != 0) {
     // Error 402: No such server
-    queue_.push(std::make_pair(fd, numeric_reply_(402, fd, message[1])));
+    send_numeric_(402, fd, message[1]);
     return;
   }
   // RPL_MOTDSTART (375)
@@ -185,44 +147,94 @@ void Server::motd_(int fd, std::vector<std::string> &message) {
 }
 
 void Server::motd_start_(int fd) {
-  std::stringstream servermessage;
-  servermessage << ":" << server_name_ << " 375 " << clients_[fd].get_nickname()
-                << " :- " << server_name_ << " Message of the day - ";
-  queue_.push(std::make_pair(fd, servermessage.str()));
+  ReplyBuilder reply(reply_to_(fd), 375);
+  reply << " :- " << server_name_ << " Message of the day - ";
+  reply.send();
 }
 
 void Server::motd_message_(int fd) {
-  std::ifstream infile;
-  try {
-#if DEBUG
-    std::cout << "Trying to open file" << std::endl;
-#endif
-    infile.open("ressources/motd.txt",
-                std::ifstream::in | std::ifstream::binary);
-    if (infile.fail()) throw std::exception();
-  } catch (std::exception &e) {
+  refresh_motd_();
+  if (motd_lines_.empty()) {
     // Error 422: MOTD File is missing
-    queue_.push(std::make_pair(fd, numeric_reply_(422, fd, "")));
+    send_numeric_(422, fd, "");
     return;
   }
 
+  Client &client = reply_to_(fd);
+  for (size_t i = 0; i < motd_lines_.size(); ++i) {
+    ReplyBuilder reply(client, 372);
+    reply << motd_lines_[i];
+    reply.send();
+  }
+}
+
+void Server::motd_end_(int fd) {
+  ReplyBuilder reply(reply_to_(fd), 376);
+  reply << " :End of /MOTD command.";
+  reply.send();
+}
+
+/**
+ * @brief Renders the parts of the welcome burst that don't depend on the
+ * client, so a registration only splices in the nickname
+ */
+void Server::init_welcome_burst_() {
+  welcome_burst_.clear();
+  welcome_burst_.push_back(std::make_pair(
+      2, " :Your host is " + server_name_ + ", running on version 1.0"));
+
+  char timebuffer[80];
+  std::memset(&timebuffer, 0, sizeof(timebuffer));
+  std::strftime(timebuffer, sizeof(timebuffer), "%a %b %d %Y at %H:%M:%S %Z",
+                std::localtime(&creation_time_));
+  welcome_burst_.push_back(
+      std::make_pair(3, std::string(" :This server was created ") +
+                            timebuffer));
+
+  welcome_burst_.push_back(
+      std::make_pair(4, std::string(" ircserv 1.0 so oitnmlbvk olbvk")));
+  welcome_burst_.push_back(std::make_pair(
+      5, std::string(" MAXCHANNELS=10 NICKLEN=9 CHANMODES=b,k,l,imnt :are "
+                     "supported by this server")));
+}
+
+// 0 if the file can't be found
+static uint64_t motd_file_mtime() {
+  struct stat info;
+  if (stat(MOTD_FILE, &info) < 0) return 0;
+  return (uint64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+}
+
+/**
+ * @brief Reads the MOTD file into motd_lines_, one reply text per line. Runs
+ * at startup, on SIGHUP and when the file changed; MOTD requests are served
+ * from memory.
+ */
+void Server::load_motd_() {
+  motd_lines_.clear();
+  motd_mtime_ = motd_file_mtime();
+  std::ifstream infile(MOTD_FILE, std::ifstream::in | std::ifstream::binary);
+  if (infile.fail()) return;
+
   std::string line;
-  std::string clientname = clients_[fd].get_nickname();
   while (infile.good()) {
     std::getline(infile, line);
-    std::stringstream servermessage;
-    servermessage << ":" << server_name_ << " 372 " << clientname << " :"
-                  << line;
-    queue_.push(std::make_pair(fd, servermessage.str()));
+    motd_lines_.push_back(" :" + line);
   }
-  infile.close();
+#if DEBUG
+  std::cout << "Loaded MOTD with " << motd_lines_.size() << " lines"
+            << std::endl;
+#endif
 }
 
-void Server::motd_end_(int fd) {
-  std::stringstream servermessage;
-  servermessage << ":" << server_name_ << " 376 " << clients_[fd].get_nickname()
-                << " :End of /MOTD command.";
-  queue_.push(std::make_pair(fd, servermessage.str()));
+/**
+ * @brief Reloads the MOTD if the file was changed. The file is looked at no
+ * more than once per tick, however many clients register in it.
+ */
+void Server::refresh_motd_() {
+  if (motd_checked_ == clock_tick_()) return;
+  motd_checked_ = clock_tick_();
+  if (motd_file_mtime() != motd_mtime_) load_motd_();
 }
 
 }  // namespace irc
\ No newline at end of file
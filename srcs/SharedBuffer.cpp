@@ -0,0 +1,53 @@
+#include "SharedBuffer.hpp"
+
+namespace irc {
+
+SharedBuffer::SharedBuffer() : data_(NULL) {}
+
+SharedBuffer::SharedBuffer(const std::string &message)
+    : data_(new shared_data) {
+  data_->refs = 1;
+  data_->bytes.reserve(message.size() + 2);
+  data_->bytes.append(message);
+  data_->bytes.append("\r\n", 2);
+}
+
+SharedBuffer SharedBuffer::with_capacity(size_t capacity) {
+  SharedBuffer block;
+  block.data_ = new shared_data;
+  block.data_->refs = 1;
+  block.data_->bytes.reserve(capacity);
+  return block;
+}
+
+SharedBuffer::SharedBuffer(const SharedBuffer &other) : data_(other.data_) {
+  if (data_) ++data_->refs;
+}
+
+SharedBuffer &SharedBuffer::operator=(const SharedBuffer &other) {
+  if (data_ != other.data_) {
+    release_();
+    data_ = other.data_;
+    if (data_) ++data_->refs;
+  }
+  return *this;
+}
+
+SharedBuffer::~SharedBuffer() { release_(); }
+
+const char *SharedBuffer::data() const {
+  return data_ ? data_->bytes.data() : NULL;
+}
+
+size_t SharedBuffer::size() const { return data_ ? data_->bytes.size() : 0; }
+
+bool SharedBuffer::is_unique() const { return data_ && data_->refs == 1; }
+
+std::string &SharedBuffer::writable_bytes() { return data_->bytes; }
+
+void SharedBuffer::release_() {
+  if (data_ && --data_->refs == 0) delete data_;
+  data_ = NULL;
+}
+
+}  // namespace irc
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "include.hpp"
+
+namespace irc {
+
+/**
+ * @brief An immutable, CRLF-terminated message shared between the send queues
+ * of all its recipients. A broadcast is formatted once; every recipient only
+ * holds a reference. The count is not atomic: send queues are only touched
+ * with the server's state lock held.
+ *
+ * A buffer that is not shared (yet) can also serve as a block that replies
+ * are formatted into in place, see SendQueue::open_block().
+ */
+class SharedBuffer {
+ public:
+  SharedBuffer();
+  explicit SharedBuffer(const std::string &message);
+  // An empty block with room for capacity bytes
+  static SharedBuffer with_capacity(size_t capacity);
+  SharedBuffer(const SharedBuffer &other);
+  SharedBuffer &operator=(const SharedBuffer &other);
+  ~SharedBuffer();
+
+  const char *data() const;
+  size_t size() const;
+  bool is_unique() const;
+  // Only while is_unique(): nobody else may see the bytes change
+  std::string &writable_bytes();
+
+ private:
+  struct shared_data {
+    size_t refs;
+    std::string bytes;
+  };
+
+  void release_();
+
+  shared_data *data_;
+};
+
+}  // namespace irc
@@ -0,0 +1,145 @@
+#include "TimerWheel.hpp"
+
+#define TIMER_HEADS (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS)
+
+namespace irc {
+
+TimerWheel::TimerWheel(uint64_t now)
+    : nodes_(TIMER_HEADS), free_(0), size_(0), now_(now) {
+  for (uint32_t i = 0; i < TIMER_HEADS; ++i) {
+    nodes_[i].prev = i;
+    nodes_[i].next = i;
+  }
+}
+
+TimerWheel::TimerWheel(const TimerWheel &other)
+    : nodes_(other.nodes_),
+      free_(other.free_),
+      size_(other.size_),
+      now_(other.now_) {}
+
+TimerWheel &TimerWheel::operator=(const TimerWheel &other) {
+  if (this != &other) {
+    nodes_ = other.nodes_;
+    free_ = other.free_;
+    size_ = other.size_;
+    now_ = other.now_;
+  }
+  return *this;
+}
+
+TimerWheel::~TimerWheel() {}
+
+uint32_t TimerWheel::slot_head_(size_t level, uint64_t tick) const {
+  return level * TIMER_WHEEL_SLOTS +
+         ((tick >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1));
+}
+
+/**
+ * @brief Puts a node into the slot of its deadline: the lowest level whose
+ * span still reaches it from now_. A deadline of now_ itself only comes from
+ * a move down and lands in the level 0 slot that fires next. A deadline
+ * beyond the top level's span waits in its last slot, keeping the real
+ * deadline, and is placed again when that slot moves down.
+ */
+void TimerWheel::link_(uint32_t index) {
+  timer_node &node = nodes_[index];
+  uint64_t delta = node.deadline - now_;
+  size_t level = 0;
+  while (level + 1 < TIMER_WHEEL_LEVELS &&
+         delta >= (uint64_t)1 << ((level + 1) * TIMER_WHEEL_BITS))
+    ++level;
+  uint64_t span = (uint64_t)1 << ((level + 1) * TIMER_WHEEL_BITS);
+  uint64_t slot_tick = delta < span ? node.deadline : now_ + span - 1;
+
+  uint32_t head = slot_head_(level, slot_tick);
+  node.prev = nodes_[head].prev;
+  node.next = head;
+  nodes_[node.prev].next = index;
+  nodes_[head].prev = index;
+}
+
+void TimerWheel::unlink_(uint32_t index) {
+  timer_node &node = nodes_[index];
+  nodes_[node.prev].next = node.next;
+  nodes_[node.next].prev = node.prev;
+}
+
+timer_handle TimerWheel::arm(uint64_t deadline, client_id id) {
+  uint32_t index = free_;
+  if (index) {
+    free_ = nodes_[index].next;
+  } else {
+    index = nodes_.size();
+    nodes_.push_back(timer_node());
+  }
+  // Overdue timers fire with the next tick
+  nodes_[index].deadline = deadline > now_ ? deadline : now_ + 1;
+  nodes_[index].id = id;
+  link_(index);
+  ++size_;
+  return index;
+}
+
+void TimerWheel::cancel(timer_handle timer) {
+  unlink_(timer);
+  nodes_[timer].next = free_;
+  free_ = timer;
+  --size_;
+}
+
+/**
+ * @brief Processes one tick: first the higher level slots that come into
+ * range now are spread over the levels below (from the top down), then the
+ * level 0 slot of the tick fires.
+ */
+void TimerWheel::tick_(std::vector<client_id> &expired) {
+  ++now_;
+
+  size_t top = 0;
+  while (top + 1 < TIMER_WHEEL_LEVELS &&
+         (now_ & (((uint64_t)1 << ((top + 1) * TIMER_WHEEL_BITS)) - 1)) == 0)
+    ++top;
+  for (size_t level = top; level > 0; --level) {
+    uint32_t head = slot_head_(level, now_);
+    uint32_t index = nodes_[head].next;
+    nodes_[head].prev = head;
+    nodes_[head].next = head;
+    while (index != head) {
+      uint32_t next = nodes_[index].next;
+      link_(index);
+      index = next;
+    }
+  }
+
+  uint32_t head = slot_head_(0, now_);
+  while (nodes_[head].next != head) {
+    uint32_t index = nodes_[head].next;
+    expired.push_back(nodes_[index].id);
+    cancel(index);
+  }
+}
+
+void TimerWheel::advance(uint64_t now, std::vector<client_id> &expired) {
+  // Nothing to move: long idle stretches cost nothing
+  if (!size_ && now > now_) now_ = now;
+  while (now_ < now) tick_(expired);
+}
+
+/**
+ * @brief The first armed level 0 slot before the next move down, or that
+ * move: timers of the higher levels may come due right after it.
+ */
+uint64_t TimerWheel::next_expiry() const {
+  if (!size_) return TIMER_NONE;
+  uint64_t move_down = ((now_ >> TIMER_WHEEL_BITS) + 1) << TIMER_WHEEL_BITS;
+  for (uint64_t tick = now_ + 1; tick < move_down; ++tick) {
+    uint32_t head = slot_head_(0, tick);
+    if (nodes_[head].next != head) return tick;
+  }
+  return move_down;
+}
+
+size_t TimerWheel::size() const { return size_; }
+
+}  // namespace irc
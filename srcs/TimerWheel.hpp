@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Client.hpp"
+#include "include.hpp"
+
+// Slots per level are 1 << TIMER_WHEEL_BITS
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+// Four levels of one second ticks reach about 194 days ahead; later
+// deadlines take more than one pass through the top level
+#define TIMER_WHEEL_LEVELS 4
+// next_expiry() when nothing is armed
+#define TIMER_NONE ((uint64_t)-1)
+
+namespace irc {
+
+typedef uint32_t timer_handle;
+
+/**
+ * @brief Deadlines of connections, in whole seconds (ticks). Level 0 has a
+ * slot per tick for the next 64 seconds; each level above covers 64 times
+ * the span of the one below with the same number of slots, and its timers
+ * move down a level when their slot comes into range. Arming and cancelling
+ * are O(1): every slot is a doubly linked list through one node array, and
+ * a handle is the index of its node.
+ */
+class TimerWheel {
+ public:
+  explicit TimerWheel(uint64_t now = 0);
+  TimerWheel(const TimerWheel &other);
+  TimerWheel &operator=(const TimerWheel &other);
+  ~TimerWheel();
+
+  // Fires at the first advance() to deadline or later, never before
+  timer_handle arm(uint64_t deadline, client_id id);
+  void cancel(timer_handle timer);
+  // Moves to now and appends the ids of the timers that fired
+  void advance(uint64_t now, std::vector<client_id> &expired);
+  // Tick by which advance() has to run next, TIMER_NONE if none is armed
+  uint64_t next_expiry() const;
+  size_t size() const;
+
+ private:
+  struct timer_node {
+    uint32_t prev;
+    uint32_t next;
+    uint64_t deadline;
+    client_id id;
+  };
+
+  uint32_t slot_head_(size_t level, uint64_t tick) const;
+  void link_(uint32_t index);
+  void unlink_(uint32_t index);
+  void tick_(std::vector<client_id> &expired);
+
+  // The slot heads (sentinels) first, then the timers; a free node is
+  // chained through next
+  std::vector<timer_node> nodes_;
+  uint32_t free_;
+  size_t size_;
+  // Last tick that was processed
+  uint64_t now_;
+};
+
+}  // namespace irc
@@ -0,0 +1,438 @@
+#include "UringBackend.hpp"
+
+namespace irc {
+
+// What a completion belongs to, in the low bits of its user_data. Sends carry
+// a pointer to their io_send (aligned, so the bits are free), the others
+// the fd in the high and the connection tag in the middle bits.
+enum uring_op {
+  URING_OP_ACCEPT = 1,
+  URING_OP_RECV,
+  URING_OP_POLL,
+  URING_OP_SEND,
+  URING_OP_CANCEL
+};
+#define URING_OP_MASK ((uint64_t)7)
+#define URING_TAG_MASK 0xffffffU
+
+static uint64_t pack_user_data(uring_op op, int fd, uint32_t tag) {
+  return (uint64_t)op | (uint64_t)(tag & URING_TAG_MASK) << 8 |
+         (uint64_t)(uint32_t)fd << 32;
+}
+
+UringBackend::UringBackend()
+    : ring_fd_(-1),
+      ring_(MAP_FAILED),
+      ring_size_(0),
+      sqes_(NULL),
+      sqes_size_(0),
+      sq_head_(NULL),
+      sq_tail_(NULL),
+      sq_array_(NULL),
+      sq_mask_(0),
+      sq_entries_(0),
+      sq_local_tail_(0),
+      cq_head_(NULL),
+      cq_tail_(NULL),
+      cq_mask_(0),
+      cqes_(NULL),
+      buf_ring_(NULL),
+      buffers_(NULL),
+      buf_tail_(0),
+      used_buffers_(),
+      listen_fd_(-1),
+      wake_fd_(-1),
+      shutdown_fd_(-1),
+      accepting_(true),
+      accept_armed_(false),
+      wake_ended_(false),
+      recv_ended_(),
+      conns_(),
+      removed_(),
+      taken_() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+  if (ring_fd_ < 0) throw std::runtime_error("io_uring is not available");
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP) ||
+      !(params.features & IORING_FEAT_EXT_ARG)) {
+    close(ring_fd_);
+    throw std::runtime_error("io_uring is too old");
+  }
+
+  // Both rings share one mapping
+  size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cq_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring_size_ = std::max(sq_size, cq_size);
+  ring_ = mmap(NULL, ring_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+    if (ring_ != MAP_FAILED) munmap(ring_, ring_size_);
+    if (sqes != MAP_FAILED) munmap(sqes, sqes_size_);
+    close(ring_fd_);
+    throw std::runtime_error("Failed to map the io_uring");
+  }
+  char *ring = static_cast<char *>(ring_);
+  sqes_ = static_cast<struct io_uring_sqe *>(sqes);
+  sq_head_ = reinterpret_cast<unsigned *>(ring + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(ring + params.sq_off.tail);
+  sq_array_ = reinterpret_cast<unsigned *>(ring + params.sq_off.array);
+  sq_mask_ = *reinterpret_cast<unsigned *>(ring + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sq_local_tail_ = *sq_tail_;
+  cq_head_ = reinterpret_cast<unsigned *>(ring + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(ring + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned *>(ring + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe *>(ring + params.cq_off.cqes);
+
+  // The receive buffers: recvs take one each, wait() gives them back
+  void *buf_ring = NULL;
+  if (posix_memalign(&buf_ring, sysconf(_SC_PAGESIZE),
+                     URING_BUFFERS * sizeof(struct io_uring_buf)) != 0) {
+    munmap(sqes_, sqes_size_);
+    munmap(ring_, ring_size_);
+    close(ring_fd_);
+    throw std::runtime_error("Failed to allocate the io_uring buffer ring");
+  }
+  memset(buf_ring, 0, URING_BUFFERS * sizeof(struct io_uring_buf));
+  buf_ring_ = static_cast<struct io_uring_buf *>(buf_ring);
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)buf_ring_;
+  reg.ring_entries = URING_BUFFERS;
+  reg.bgid = URING_BUFFER_GROUP;
+  if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PBUF_RING,
+              &reg, 1) < 0) {
+    free(buf_ring_);
+    munmap(sqes_, sqes_size_);
+    munmap(ring_, ring_size_);
+    close(ring_fd_);
+    throw std::runtime_error("io_uring has no provided buffer rings");
+  }
+  buffers_ = new char[URING_BUFFERS * URING_BUFFER_SIZE];
+  for (uint16_t bid = 0; bid < URING_BUFFERS; ++bid) add_buffer_(bid);
+  publish_buffers_();
+}
+
+UringBackend::~UringBackend() {
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.bgid = URING_BUFFER_GROUP;
+  syscall(__NR_io_uring_register, ring_fd_, IORING_UNREGISTER_PBUF_RING, &reg,
+          1);
+  munmap(sqes_, sqes_size_);
+  munmap(ring_, ring_size_);
+  close(ring_fd_);
+  free(buf_ring_);
+  delete[] buffers_;
+}
+
+const char *UringBackend::name() const { return "io_uring"; }
+
+void UringBackend::watch(int listen_fd, int wake_fd, int shutdown_fd) {
+  listen_fd_ = listen_fd;
+  wake_fd_ = wake_fd;
+  shutdown_fd_ = shutdown_fd;
+  arm_accept_();
+  arm_poll_(wake_fd_, true);
+  // Single shot: the shutdown eventfd stays set for every reactor
+  arm_poll_(shutdown_fd_, false);
+}
+
+int UringBackend::add(int fd) {
+  uring_conn &conn = conn_(fd);
+  conn.tag = (conn.tag + 1) & URING_TAG_MASK;
+  conn.open = true;
+  conn.reading = true;
+  arm_recv_(fd, conn.tag);
+  return 0;
+}
+
+// Applied by the owner's rearm(), which comes before it closes the fd
+void UringBackend::remove(int fd) {
+  forget_send_(fd);
+  removed_.push_back(fd);
+}
+
+/**
+ * @brief The multishot recv would go on filling buffers, so it is cancelled;
+ * once it ended, rearm() starts a new one if reading resumed meanwhile.
+ */
+void UringBackend::set_reading(int fd, bool reading) {
+  uring_conn &conn = conn_(fd);
+  if (!conn.open || conn.reading == reading) return;
+
+  conn.reading = reading;
+  if (!reading && conn.receiving) cancel_recv_(fd, conn.tag);
+  if (reading && !conn.receiving)
+    recv_ended_.push_back(std::make_pair(fd, conn.tag));
+}
+
+bool UringBackend::is_current(int fd, uint32_t tag) const {
+  return fd >= 0 && (size_t)fd < conns_.size() && conns_[fd].open &&
+         conns_[fd].tag == tag;
+}
+
+/**
+ * @brief Requests of a removed connection may still complete after it is
+ * closed; the new tag marks their completions as stale. The shutdown() makes
+ * a pending recv end right away.
+ */
+// The accept ends with -ECANCELED, which the server ignores
+void UringBackend::set_accepting(bool accepting) {
+  accepting_ = accepting;
+  if (!accepting && accept_armed_) cancel_accept_();
+}
+
+void UringBackend::rearm() {
+  for (size_t i = 0; i < removed_.size(); ++i) {
+    uring_conn &conn = conn_(removed_[i]);
+    conn.tag = (conn.tag + 1) & URING_TAG_MASK;
+    conn.open = false;
+    shutdown(removed_[i], SHUT_RDWR);
+  }
+  removed_.clear();
+  take_sends_(taken_);
+  for (size_t i = 0; i < taken_.size(); ++i) arm_send_(taken_[i]);
+  taken_.clear();
+
+  if (accepting_ && !accept_armed_) arm_accept_();
+  if (wake_ended_) {
+    wake_ended_ = false;
+    arm_poll_(wake_fd_, true);
+  }
+  for (size_t i = 0; i < recv_ended_.size(); ++i) {
+    int fd = recv_ended_[i].first;
+    if (is_current(fd, recv_ended_[i].second) && conns_[fd].reading &&
+        !conns_[fd].receiving)
+      arm_recv_(fd, recv_ended_[i].second);
+  }
+  recv_ended_.clear();
+}
+
+/**
+ * @brief Gives back the buffers of the last call, submits every request
+ * queued since and waits for completions in one io_uring_enter()
+ */
+int UringBackend::wait(std::vector<io_event> &events, int timeout_ms) {
+  for (size_t i = 0; i < used_buffers_.size(); ++i)
+    add_buffer_(used_buffers_[i]);
+  if (!used_buffers_.empty()) publish_buffers_();
+  used_buffers_.clear();
+
+  unsigned cq_head = *cq_head_;
+  bool ready = cq_head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  struct __kernel_timespec timeout;
+  memset(&timeout, 0, sizeof(timeout));
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+  arg.ts = timeout_ms < 0 ? 0 : (uint64_t)(uintptr_t)&timeout;
+  unsigned wait_for = ready || timeout_ms == 0 ? 0 : 1;
+  // Exactly what is queued: the kernel doesn't wait after submitting less
+  // than it was told to
+  unsigned queued = __atomic_load_n(sq_tail_, __ATOMIC_ACQUIRE) -
+                    __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+
+  if (syscall(__NR_io_uring_enter, ring_fd_, queued, wait_for,
+              IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+              sizeof(arg)) < 0 &&
+      errno != ETIME && errno != EBUSY) {
+    if (errno == EINTR) return -1;
+    throw std::runtime_error("io_uring_enter failed");
+  }
+
+  size_t before = events.size();
+  unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  for (; cq_head != cq_tail; ++cq_head)
+    handle_cqe_(cqes_[cq_head & cq_mask_], events);
+  __atomic_store_n(cq_head_, cq_head, __ATOMIC_RELEASE);
+  return events.size() - before;
+}
+
+/**
+ * @brief Next free submission entry. A full ring is submitted at once; that
+ * consumes every entry, as there is no kernel thread polling the ring.
+ */
+struct io_uring_sqe *UringBackend::next_sqe_() {
+  unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (sq_local_tail_ - head >= sq_entries_)
+    syscall(__NR_io_uring_enter, ring_fd_, sq_local_tail_ - head, 0, 0, NULL,
+            0);
+  unsigned index = sq_local_tail_ & sq_mask_;
+  struct io_uring_sqe *sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sq_array_[index] = index;
+  return sqe;
+}
+
+void UringBackend::commit_sqe_() {
+  ++sq_local_tail_;
+  __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+}
+
+void UringBackend::arm_accept_() {
+  struct io_uring_sqe *sqe = next_sqe_();
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = listen_fd_;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  // Like accept4() on epoll: a final flush must never block
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  sqe->user_data = pack_user_data(URING_OP_ACCEPT, listen_fd_, 0);
+  commit_sqe_();
+  accept_armed_ = true;
+}
+
+void UringBackend::cancel_accept_() {
+  struct io_uring_sqe *sqe = next_sqe_();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = pack_user_data(URING_OP_ACCEPT, listen_fd_, 0);
+  sqe->user_data = pack_user_data(URING_OP_CANCEL, listen_fd_, 0);
+  commit_sqe_();
+}
+
+void UringBackend::arm_recv_(int fd, uint32_t tag) {
+  struct io_uring_sqe *sqe = next_sqe_();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = URING_BUFFER_GROUP;
+  sqe->user_data = pack_user_data(URING_OP_RECV, fd, tag);
+  commit_sqe_();
+  conn_(fd).receiving = true;
+}
+
+void UringBackend::arm_poll_(int fd, bool multishot) {
+  struct io_uring_sqe *sqe = next_sqe_();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = POLLIN;
+  if (multishot) sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = pack_user_data(URING_OP_POLL, fd, 0);
+  commit_sqe_();
+}
+
+// The kernel reads the iovecs once the request is submitted by wait()
+void UringBackend::arm_send_(io_send *pending) {
+  pending->tag = conn_(pending->fd).tag;
+  struct io_uring_sqe *sqe = next_sqe_();
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = pending->fd;
+  sqe->addr = (uint64_t)(uintptr_t)&pending->header;
+  sqe->len = 1;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = (uint64_t)(uintptr_t)pending | URING_OP_SEND;
+  commit_sqe_();
+}
+
+// The recv ends with -ECANCELED, the cancel's own completion is ignored
+void UringBackend::cancel_recv_(int fd, uint32_t tag) {
+  struct io_uring_sqe *sqe = next_sqe_();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = pack_user_data(URING_OP_RECV, fd, tag);
+  sqe->user_data = pack_user_data(URING_OP_CANCEL, fd, tag);
+  commit_sqe_();
+}
+
+// Published by the caller, with one tail update for all of them
+void UringBackend::add_buffer_(uint16_t bid) {
+  struct io_uring_buf *buf = &buf_ring_[buf_tail_ & (URING_BUFFERS - 1)];
+  buf->addr = (uint64_t)(uintptr_t)(buffers_ + (size_t)bid * URING_BUFFER_SIZE);
+  buf->len = URING_BUFFER_SIZE;
+  buf->bid = bid;
+  ++buf_tail_;
+}
+
+/**
+ * @brief The ring's tail overlays the reserved field of its first entry. It
+ * is not reached through io_uring_buf_ring: in C++ the empty struct in front
+ * of its flexible array takes a byte, which moves the entries.
+ */
+void UringBackend::publish_buffers_() {
+  __atomic_store_n(&buf_ring_[0].resv, buf_tail_, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Turns a completion into an io_event. A multishot request without
+ * IORING_CQE_F_MORE has ended and is noted for rearm(); a recv ends like that
+ * when the buffer ring ran dry (-ENOBUFS) or reading stopped (-ECANCELED),
+ * neither of which is an error.
+ */
+void UringBackend::handle_cqe_(const struct io_uring_cqe &cqe,
+                               std::vector<io_event> &events) {
+  io_event event;
+  memset(&event, 0, sizeof(event));
+  uring_op op = static_cast<uring_op>(cqe.user_data & URING_OP_MASK);
+  bool more = cqe.flags & IORING_CQE_F_MORE;
+
+  if (op == URING_OP_SEND) {
+    io_send *done = reinterpret_cast<io_send *>(
+        (uintptr_t)(cqe.user_data & ~URING_OP_MASK));
+    done->result = cqe.res;
+    event.type = IO_SENT;
+    event.fd = done->fd;
+    event.tag = done->tag;
+    event.token = (uintptr_t)done;
+    event.size = done->size;
+    event.result = cqe.res;
+    events.push_back(event);
+    return;
+  }
+
+  event.fd = (int)(cqe.user_data >> 32);
+  event.tag = (cqe.user_data >> 8) & URING_TAG_MASK;
+  if (op == URING_OP_CANCEL) return;
+  if (op == URING_OP_ACCEPT) {
+    if (!more) accept_armed_ = false;
+    if (cqe.res < 0) {
+      event.type = IO_ACCEPT_FAILED;
+      event.result = cqe.res;
+    } else {
+      event.type = IO_ACCEPTED;
+      event.fd = cqe.res;
+    }
+    events.push_back(event);
+  } else if (op == URING_OP_POLL) {
+    if (!more && event.fd == wake_fd_) wake_ended_ = true;
+    event.type = IO_WAKE;
+    events.push_back(event);
+  } else if (op == URING_OP_RECV) {
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+      uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+      used_buffers_.push_back(bid);
+      event.data = buffers_ + (size_t)bid * URING_BUFFER_SIZE;
+    }
+    if (!more && is_current(event.fd, event.tag))
+      conns_[event.fd].receiving = false;
+    if (cqe.res == -ENOBUFS || cqe.res == -ECANCELED) {
+      recv_ended_.push_back(std::make_pair(event.fd, event.tag));
+      return;
+    }
+    if (cqe.res > 0) {
+      if (!more) recv_ended_.push_back(std::make_pair(event.fd, event.tag));
+      event.type = IO_DATA;
+      event.size = cqe.res;
+    } else
+      event.type = IO_EOF;
+    events.push_back(event);
+  }
+}
+
+UringBackend::uring_conn &UringBackend::conn_(int fd) {
+  if ((size_t)fd >= conns_.size()) {
+    uring_conn closed = {0, false, false, false};
+    conns_.resize(fd + 1, closed);
+  }
+  return conns_[fd];
+}
+
+}  // namespace irc
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "EventBackend.hpp"
+#include "include.hpp"
+
+// Submission queue entries per ring
+#define URING_ENTRIES 4096
+// Provided receive buffers per ring (a power of two) and their size
+#define URING_BUFFERS 512
+#define URING_BUFFER_SIZE 4096
+#define URING_BUFFER_GROUP 0
+
+namespace irc {
+
+/**
+ * @brief Completion based I/O on an io_uring, driven by raw syscalls. One
+ * multishot accept feeds new connections, every connection has one multishot
+ * recv that picks its buffers from a provided buffer ring, and sends are
+ * sendmsg() requests over the send queue's chunks. Requests are written to
+ * the ring while the event loop handles its events and all go to the kernel
+ * with the next wait(), in a single io_uring_enter().
+ *
+ * Only the owning reactor writes to and enters the ring and keeps the state
+ * of the connections. The sends and removals other threads record are
+ * applied in its rearm().
+ */
+class UringBackend : public EventBackend {
+ public:
+  UringBackend();
+  ~UringBackend();
+
+  const char *name() const;
+  void watch(int listen_fd, int wake_fd, int shutdown_fd);
+  int add(int fd);
+  void remove(int fd);
+  void set_reading(int fd, bool reading);
+  void set_accepting(bool accepting);
+  bool is_current(int fd, uint32_t tag) const;
+  void rearm();
+  int wait(std::vector<io_event> &events, int timeout_ms);
+
+ private:
+  struct uring_conn {
+    // Tells this connection's completions from those of an earlier one
+    uint32_t tag;
+    bool open;
+    // Whether the server takes input, and whether a recv is in flight
+    bool reading;
+    bool receiving;
+  };
+
+  struct io_uring_sqe *next_sqe_();
+  void commit_sqe_();
+  void arm_accept_();
+  void cancel_accept_();
+  void arm_recv_(int fd, uint32_t tag);
+  void arm_poll_(int fd, bool multishot);
+  void arm_send_(io_send *pending);
+  void cancel_recv_(int fd, uint32_t tag);
+  void add_buffer_(uint16_t bid);
+  void publish_buffers_();
+  void handle_cqe_(const struct io_uring_cqe &cqe,
+                   std::vector<io_event> &events);
+  uring_conn &conn_(int fd);
+
+  int ring_fd_;
+  void *ring_;
+  size_t ring_size_;
+  struct io_uring_sqe *sqes_;
+  size_t sqes_size_;
+  unsigned *sq_head_;
+  unsigned *sq_tail_;
+  unsigned *sq_array_;
+  unsigned sq_mask_;
+  unsigned sq_entries_;
+  // Entries written so far, published to the kernel by commit_sqe_()
+  unsigned sq_local_tail_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned cq_mask_;
+  struct io_uring_cqe *cqes_;
+
+  // Entries of the provided buffer ring
+  struct io_uring_buf *buf_ring_;
+  char *buffers_;
+  uint16_t buf_tail_;
+  // Handed out by the last wait(), given back by the next one
+  std::vector<uint16_t> used_buffers_;
+
+  int listen_fd_;
+  int wake_fd_;
+  int shutdown_fd_;
+  // Whether the listener is to be reported, and whether the multishot accept
+  // is still armed; rearm() arms it again if not
+  bool accepting_;
+  bool accept_armed_;
+  // Multishot requests that ended and have to be armed again by rearm()
+  bool wake_ended_;
+  std::vector<std::pair<int, uint32_t> > recv_ended_;
+
+  // Indexed by fd, only touched by the owner
+  std::vector<uring_conn> conns_;
+  // Recorded by remove() from any thread, with the server lock held
+  std::vector<int> removed_;
+  // Scratch for rearm()
+  std::vector<io_send *> taken_;
+};
+
+}  // namespace irc
@@ -0,0 +1,86 @@
+#include "WildcardMask.hpp"
+
+namespace irc {
+
+WildcardMask::WildcardMask()
+    : segments_(1), prefix_(), suffix_(), literal_(true) {}
+
+WildcardMask::WildcardMask(const std::string &mask)
+    : segments_(), prefix_(), suffix_(), literal_(false) {
+  std::string folded = irc_casefold(mask);
+
+  size_t begin = 0;
+  size_t star;
+  while ((star = folded.find('*', begin)) != std::string::npos) {
+    segments_.push_back(folded.substr(begin, star - begin));
+    begin = star + 1;
+  }
+  segments_.push_back(folded.substr(begin));
+
+  size_t first_wildcard = folded.find_first_of("*?");
+  literal_ = first_wildcard == std::string::npos;
+  if (literal_) {
+    prefix_ = folded;
+    suffix_ = folded;
+  } else {
+    prefix_ = folded.substr(0, first_wildcard);
+    suffix_ = folded.substr(folded.find_last_of("*?") + 1);
+  }
+}
+
+WildcardMask::WildcardMask(const WildcardMask &other)
+    : segments_(other.segments_),
+      prefix_(other.prefix_),
+      suffix_(other.suffix_),
+      literal_(other.literal_) {}
+
+WildcardMask &WildcardMask::operator=(const WildcardMask &other) {
+  if (this != &other) {
+    segments_ = other.segments_;
+    prefix_ = other.prefix_;
+    suffix_ = other.suffix_;
+    literal_ = other.literal_;
+  }
+  return *this;
+}
+
+WildcardMask::~WildcardMask() {}
+
+bool WildcardMask::segment_at_(const std::string &segment,
+                               const std::string &subject, size_t pos) {
+  for (size_t i = 0; i < segment.size(); ++i) {
+    if (segment[i] != '?' && segment[i] != subject[pos + i]) return false;
+  }
+  return true;
+}
+
+bool WildcardMask::matches(const std::string &folded) const {
+  const std::string &first = segments_.front();
+  if (segments_.size() == 1)
+    return folded.size() == first.size() && segment_at_(first, folded, 0);
+
+  const std::string &last = segments_.back();
+  if (folded.size() < first.size() + last.size()) return false;
+  if (!segment_at_(first, folded, 0)) return false;
+  size_t end = folded.size() - last.size();
+  if (!segment_at_(last, folded, end)) return false;
+
+  // Each inner segment at its leftmost place between the anchored ends
+  size_t pos = first.size();
+  for (size_t i = 1; i + 1 < segments_.size(); ++i) {
+    const std::string &segment = segments_[i];
+    while (pos + segment.size() <= end && !segment_at_(segment, folded, pos))
+      ++pos;
+    if (pos + segment.size() > end) return false;
+    pos += segment.size();
+  }
+  return true;
+}
+
+bool WildcardMask::is_literal() const { return literal_; }
+
+const std::string &WildcardMask::literal_prefix() const { return prefix_; }
+
+const std::string &WildcardMask::literal_suffix() const { return suffix_; }
+
+}  // namespace irc
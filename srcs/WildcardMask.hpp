@@ -0,0 +1,44 @@
+#pragma once
+
+#include "include.hpp"
+
+namespace irc {
+
+/**
+ * @brief A casefolded wildcard pattern ('*' any run of bytes, '?' any one
+ * byte) split once into the literal segments between its stars.
+ *
+ * The first segment is anchored at the start of the subject and the last one
+ * at its end; the ones in between are searched for left to right, and the
+ * leftmost place of each is always the right one, so a match never
+ * backtracks. Cost is bounded by subject size times segment size, instead of
+ * the exponential worst case of a recursive matcher.
+ */
+class WildcardMask {
+ public:
+  WildcardMask();
+  explicit WildcardMask(const std::string &mask);
+  WildcardMask(const WildcardMask &other);
+  WildcardMask &operator=(const WildcardMask &other);
+  ~WildcardMask();
+
+  // The subject must already be casefolded
+  bool matches(const std::string &folded) const;
+  // No '*' or '?': matches exactly one (casefolded) string
+  bool is_literal() const;
+  // The bytes before the first and after the last wildcard, casefolded
+  const std::string &literal_prefix() const;
+  const std::string &literal_suffix() const;
+
+ private:
+  static bool segment_at_(const std::string &segment,
+                          const std::string &subject, size_t pos);
+
+  // Casefolded pattern split at every '*'; one segment means no '*'
+  std::vector<std::string> segments_;
+  std::string prefix_;
+  std::string suffix_;
+  bool literal_;
+};
+
+}  // namespace irc
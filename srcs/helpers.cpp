@@ -1,4 +1,5 @@
 #include "include.hpp"
+#include "kernels.hpp"
 
 namespace irc {
 
@@ -10,40 +11,19 @@ std::vector<std::string> split_string(std::string& line, char delim) {
   return ret;
 }
 
-static bool irc_charissame(char a, char b) {
-  if (a == b) return true;
-  if ((a == '[' || a == '{') && (b == '[' || b == '{'))
-    return true;
-  else if ((a == ']' || a == '}') && (b == ']' || b == '}'))
-    return true;
-  else if ((a == '\\' || a == '|') && (b == '\\' || b == '|'))
-    return true;
-  else if (isupper(a) && islower(b) && a == b - 32)
-    return true;
-  else if (isupper(b) && islower(a) && b == a - 32)
-    return true;
-  return false;
-}
-
 bool irc_stringissame(const std::string& str1, const std::string& str2) {
   if (str1.size() != str2.size()) return false;
-  for (size_t i = 0; i < str1.size(); ++i) {
-    if (!irc_charissame(str1.at(i), str2.at(i))) return false;
-  }
-  return true;
+  return kernels.casefold_equal(str1.data(), str2.data(), str1.size());
 }
 
-bool irc_customlesscomparator(const char* str1, const char* str2) {
-  int i = 0;
-  while (str1[i] != '\0' && str2[i] != '\0') {
-    if (!irc_charissame(str1[i], str2[i])) {
-      return (str1[i] < str2[i]) ? true : false;
-    }
-    i++;
-  }
-  return (str1[i] == '\0' && str2[i] == '\0')
-             ? false
-             : ((str1[i] == '\0') ? true : false);
+/**
+ * @brief Lowercases a name by the IRC case mapping: A-Z and the brackets
+ * []\ become a-z and {}|. Equal folds mean irc_stringissame.
+ */
+std::string irc_casefold(const std::string& str) {
+  std::string folded(str);
+  if (!folded.empty()) kernels.casefold(&folded[0], folded.size());
+  return folded;
 }
 
 bool channel_key_is_valid(std::string& key) {
@@ -53,32 +33,6 @@ bool channel_key_is_valid(std::string& key) {
   return true;
 }
 
-bool irc_wildcard_cmp(const char* string, const char* mask) {
-  while (*string && *mask) {
-    if (irc_charissame(*mask, *string) || *mask == '?') {
-      mask++;
-      string++;
-    } else if (*mask == '*') {
-      while (*mask == '*') {
-        mask++;
-      }
-      if (*mask == '\0') {
-        return true;
-      }
-      while (*string) {
-        if (irc_wildcard_cmp(string, mask)) {
-          return true;
-        }
-        string++;
-      }
-      return false;
-    } else {
-      return false;
-    }
-  }
-  return ((*mask == '*' || *mask == '\0') && *string == '\0');
-}
-
 void parse_banmask(const std::string& arg, std::string& banmask_nickname,
                    std::string& banmask_username,
                    std::string& banmask_hostname) {
@@ -0,0 +1,227 @@
+#include "kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#else
+#define HAVE_X86_KERNELS 0
+#endif
+
+// Most bytes find_any_of looks for at once
+#define ANY_OF_MAX 8
+
+namespace irc {
+
+static inline bool is_foldable(char c) { return c >= 'A' && c <= ']'; }
+
+static inline bool is_unprintable(char c) { return c < 0x20 || c > 0x7e; }
+
+// Scalar versions, also used for the tails of the vector versions
+
+static const char *find_crlf_scalar(const char *begin, const char *end) {
+  const char *cr = begin;
+  while ((cr = static_cast<const char *>(memchr(cr, '\r', end - cr)))) {
+    if (cr + 1 == end) return NULL;
+    if (cr[1] == '\n') return cr;
+    ++cr;
+  }
+  return NULL;
+}
+
+static void casefold_scalar(char *data, size_t size) {
+  for (size_t i = 0; i < size; ++i)
+    if (is_foldable(data[i])) data[i] += 32;
+}
+
+static bool casefold_equal_scalar(const char *a, const char *b, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    char ca = is_foldable(a[i]) ? a[i] + 32 : a[i];
+    char cb = is_foldable(b[i]) ? b[i] + 32 : b[i];
+    if (ca != cb) return false;
+  }
+  return true;
+}
+
+static const char *find_any_of_scalar(const char *begin, const char *end,
+                                      const char *set) {
+  for (; begin != end; ++begin)
+    if (*begin && strchr(set, *begin)) return begin;
+  return end;
+}
+
+static const char *find_unprintable_scalar(const char *begin,
+                                           const char *end) {
+  while (begin != end && !is_unprintable(*begin)) ++begin;
+  return begin;
+}
+
+#if HAVE_X86_KERNELS
+
+// The 16 and 32 byte versions are the same code on different registers.
+// Signed compares are fine for the ranges: bytes >= 0x80 are negative.
+
+static inline int lowest_bit(unsigned mask) { return __builtin_ctz(mask); }
+
+__attribute__((target("sse2"))) static inline __m128i casefold_sse2_block(
+    __m128i bytes) {
+  __m128i foldable =
+      _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1)),
+                    _mm_cmplt_epi8(bytes, _mm_set1_epi8(']' + 1)));
+  return _mm_add_epi8(bytes, _mm_and_si128(foldable, _mm_set1_epi8(32)));
+}
+
+__attribute__((target("sse2"))) static void casefold_sse2(char *data,
+                                                          size_t size) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i *block = reinterpret_cast<__m128i *>(data + i);
+    _mm_storeu_si128(block, casefold_sse2_block(_mm_loadu_si128(block)));
+  }
+  casefold_scalar(data + i, size - i);
+}
+
+__attribute__((target("sse2"))) static bool casefold_equal_sse2(
+    const char *a, const char *b, size_t size) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i fa = casefold_sse2_block(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)));
+    __m128i fb = casefold_sse2_block(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(fa, fb)) != 0xffff) return false;
+  }
+  return casefold_equal_scalar(a + i, b + i, size - i);
+}
+
+__attribute__((target("sse2"))) static const char *find_any_of_sse2(
+    const char *begin, const char *end, const char *set) {
+  size_t n_set = strlen(set);
+  if (n_set > ANY_OF_MAX) return find_any_of_scalar(begin, end, set);
+  __m128i wanted[ANY_OF_MAX];
+  for (size_t i = 0; i < n_set; ++i) wanted[i] = _mm_set1_epi8(set[i]);
+
+  const char *it = begin;
+  for (; end - it >= 16; it += 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(it));
+    __m128i hits = _mm_setzero_si128();
+    for (size_t i = 0; i < n_set; ++i)
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, wanted[i]));
+    unsigned mask = _mm_movemask_epi8(hits);
+    if (mask) return it + lowest_bit(mask);
+  }
+  return find_any_of_scalar(it, end, set);
+}
+
+__attribute__((target("sse2"))) static const char *find_unprintable_sse2(
+    const char *begin, const char *end) {
+  const char *it = begin;
+  for (; end - it >= 16; it += 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(it));
+    __m128i printable =
+        _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x1f)),
+                      _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x7f)));
+    unsigned mask = ~_mm_movemask_epi8(printable) & 0xffff;
+    if (mask) return it + lowest_bit(mask);
+  }
+  return find_unprintable_scalar(it, end);
+}
+
+__attribute__((target("avx2"))) static inline __m256i casefold_avx2_block(
+    __m256i bytes) {
+  __m256i foldable =
+      _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('A' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8(']' + 1), bytes));
+  return _mm256_add_epi8(bytes,
+                         _mm256_and_si256(foldable, _mm256_set1_epi8(32)));
+}
+
+__attribute__((target("avx2"))) static void casefold_avx2(char *data,
+                                                          size_t size) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i *block = reinterpret_cast<__m256i *>(data + i);
+    _mm256_storeu_si256(block, casefold_avx2_block(_mm256_loadu_si256(block)));
+  }
+  casefold_sse2(data + i, size - i);
+}
+
+__attribute__((target("avx2"))) static bool casefold_equal_avx2(
+    const char *a, const char *b, size_t size) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i fa = casefold_avx2_block(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)));
+    __m256i fb = casefold_avx2_block(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+    if ((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(fa, fb)) !=
+        0xffffffffu)
+      return false;
+  }
+  return casefold_equal_sse2(a + i, b + i, size - i);
+}
+
+__attribute__((target("avx2"))) static const char *find_any_of_avx2(
+    const char *begin, const char *end, const char *set) {
+  size_t n_set = strlen(set);
+  if (n_set > ANY_OF_MAX) return find_any_of_scalar(begin, end, set);
+  __m256i wanted[ANY_OF_MAX];
+  for (size_t i = 0; i < n_set; ++i) wanted[i] = _mm256_set1_epi8(set[i]);
+
+  const char *it = begin;
+  for (; end - it >= 32; it += 32) {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(it));
+    __m256i hits = _mm256_setzero_si256();
+    for (size_t i = 0; i < n_set; ++i)
+      hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(bytes, wanted[i]));
+    unsigned mask = _mm256_movemask_epi8(hits);
+    if (mask) return it + lowest_bit(mask);
+  }
+  return find_any_of_sse2(it, end, set);
+}
+
+__attribute__((target("avx2"))) static const char *find_unprintable_avx2(
+    const char *begin, const char *end) {
+  const char *it = begin;
+  for (; end - it >= 32; it += 32) {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(it));
+    __m256i printable =
+        _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(0x1f)),
+                         _mm256_cmpgt_epi8(_mm256_set1_epi8(0x7f), bytes));
+    unsigned mask = ~(unsigned)_mm256_movemask_epi8(printable);
+    if (mask) return it + lowest_bit(mask);
+  }
+  return find_unprintable_sse2(it, end);
+}
+
+#endif  // HAVE_X86_KERNELS
+
+static const byte_kernels scalar_kernels = {
+    find_crlf_scalar,   casefold_scalar,         casefold_equal_scalar,
+    find_any_of_scalar, find_unprintable_scalar, "scalar"};
+
+#if HAVE_X86_KERNELS
+// The CRLF search stays with memchr() in all of them: glibc's is already
+// vectorized, and in the unoptimized build the intrinsics versions were
+// slower than it
+static const byte_kernels sse2_kernels = {
+    find_crlf_scalar, casefold_sse2,         casefold_equal_sse2,
+    find_any_of_sse2, find_unprintable_sse2, "sse2"};
+
+static const byte_kernels avx2_kernels = {
+    find_crlf_scalar, casefold_avx2,         casefold_equal_avx2,
+    find_any_of_avx2, find_unprintable_avx2, "avx2"};
+#endif
+
+static const byte_kernels &select_kernels() {
+#if HAVE_X86_KERNELS
+  // Runs before main(), so the CPU model may not be initialized yet
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return avx2_kernels;
+  if (__builtin_cpu_supports("sse2")) return sse2_kernels;
+#endif
+  return scalar_kernels;
+}
+
+const byte_kernels &kernels = select_kernels();
+
+}  // namespace irc
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "include.hpp"
+
+namespace irc {
+
+/**
+ * @brief Byte loops of the protocol hot paths. Each kernel has a scalar
+ * version and, on x86, SSE2 and AVX2 versions; the widest one the CPU
+ * supports is picked once at startup.
+ */
+struct byte_kernels {
+  // Start of the first "\r\n" in [begin, end) or NULL; memchr() based on
+  // every CPU
+  const char *(*find_crlf)(const char *begin, const char *end);
+  // RFC1459 lowercase in place: A-Z[\] become a-z{|}
+  void (*casefold)(char *data, size_t size);
+  // Equal after casefolding both
+  bool (*casefold_equal)(const char *a, const char *b, size_t size);
+  // First byte that is one of the (at most 8) bytes of set, or end
+  const char *(*find_any_of)(const char *begin, const char *end,
+                             const char *set);
+  // First byte outside the printable ASCII range 0x20-0x7e, or end
+  const char *(*find_unprintable)(const char *begin, const char *end);
+  const char *name;
+};
+
+extern const byte_kernels &kernels;
+
+}  // namespace irc
@@ -1,8 +1,9 @@
 #include "Server.hpp"
 
 int main(int argc, char** argv) {
-  if (argc != 3) {
-    std::cout << "Usage: ./ircserv [port] [password]" << std::endl;
+  if (argc < 3) {
+    std::cout << "Usage: ./ircserv [port] [password] [--option=value ...]"
+              << std::endl;
     return (EXIT_FAILURE);
   }
   int port = std::atoi(argv[1]);
@@ -18,9 +19,22 @@ int main(int argc, char** argv) {
     return (EXIT_FAILURE);
   }
 
+  irc::ServerConfig config;
+  for (int i = 3; i < argc; ++i) {
+    if (!irc::parse_config_option(argv[i], config)) {
+      std::cout << "Invalid option: " << argv[i] << std::endl;
+      return (EXIT_FAILURE);
+    }
+  }
+  std::string config_error = irc::check_config(config);
+  if (!config_error.empty()) {
+    std::cout << "Invalid options: " << config_error << std::endl;
+    return (EXIT_FAILURE);
+  }
+
   irc::Server server;
   try {
-    server.init(port, password);
+    server.init(port, password, config);
   } catch (std::exception &e) {
     std::cout << e.what() << std::endl;
     return (EXIT_FAILURE);